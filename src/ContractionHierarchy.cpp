@@ -0,0 +1,706 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "ContractionHierarchy.h"
+#include "Trace.h"
+#include "WorldJournal.h"
+
+namespace {
+const uint32_t SIDECAR_MAGIC = 0x31484341; // "ACH1"
+
+/// @brief Witness searches give up after settling this many cells and assume there is no witness, which only ever
+/// adds a shortcut that was not needed
+const int WITNESS_SETTLE_LIMIT = 500;
+
+const float INFINITE_COST = std::numeric_limits<float>::infinity();
+
+/// @brief Weight of a cell with impassable cells as infinity, so passability lives in the same number
+float cell_weight(const WorldSnapshot& world, Position pos) {
+    return world.is_passable(pos) ? world.get_weight(pos) : INFINITE_COST;
+}
+
+struct Shortcut {
+    int from;
+    int to;
+    float cost;
+};
+
+/// @brief Per thread scratch space for witness searches
+class WitnessSearch {
+  private:
+    std::vector<float> cost;
+    std::vector<uint32_t> stamp;
+    std::vector<uint32_t> target_stamp;
+    uint32_t current = 0;
+
+    typedef std::pair<float, int> Entry;
+    std::vector<Entry> open;
+
+  public:
+    WitnessSearch(size_t nodes) : cost(nodes), stamp(nodes, 0), target_stamp(nodes, 0) {}
+
+    float reached(int node) {
+        return stamp[node] == current ? cost[node] : INFINITE_COST;
+    }
+
+    /// @brief Cheapest costs from source to targets that stay below limit without passing through skip or any excluded
+    /// node, stops as soon as every target is settled
+    template <typename Edges, typename Excluded>
+    void Run(int source, int skip, float limit, const std::vector<ContractionHierarchy::Edge>& targets,
+             const Edges& out, Excluded excluded) {
+        current++;
+        open.clear();
+
+        int targets_left = 0;
+        for (auto& target : targets) {
+            if (target.node != source && target_stamp[target.node] != current) {
+                target_stamp[target.node] = current;
+                targets_left++;
+            }
+        }
+
+        cost[source] = 0;
+        stamp[source] = current;
+        open.push_back({0, source});
+
+        int settled = 0;
+        while (!open.empty() && targets_left > 0 && settled < WITNESS_SETTLE_LIMIT) {
+            std::pop_heap(open.begin(), open.end(), std::greater<Entry>());
+            Entry entry = open.back();
+            open.pop_back();
+
+            if (entry.first > cost[entry.second])
+                continue;
+            if (entry.first > limit)
+                break;
+
+            settled++;
+            if (target_stamp[entry.second] == current)
+                targets_left--;
+
+            for (auto& edge : out[entry.second]) {
+                if (edge.node == skip || excluded(edge.node))
+                    continue;
+
+                float next = entry.first + edge.cost;
+                if (next < reached(edge.node)) {
+                    cost[edge.node] = next;
+                    stamp[edge.node] = current;
+                    open.push_back({next, edge.node});
+                    std::push_heap(open.begin(), open.end(), std::greater<Entry>());
+                }
+            }
+        }
+    }
+};
+
+/// @brief Runs work(i, thread) for every i below count, split in contiguous runs over threads
+template <typename Work>
+void parallel_for(size_t count, int threads, Work work) {
+    if (threads <= 1 || count < 64) {
+        for (size_t i = 0; i < count; i++)
+            work(i, 0);
+
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            for (size_t i = count * t / threads; i < count * (t + 1) / threads; i++)
+                work(i, t);
+        }));
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+class Builder {
+  public:
+    typedef ContractionHierarchy::Edge Edge;
+
+    size_t nodes;
+    std::vector<std::vector<Edge>> out;
+    std::vector<std::vector<Edge>> in;
+
+    std::vector<char> contracted;
+    std::vector<char> in_batch;
+    std::vector<int> priority;
+    std::vector<int> deleted_neighbors;
+    std::vector<int> level;
+
+    std::vector<std::vector<Edge>> forward_up;
+    std::vector<std::vector<Edge>> backward_up;
+
+    Builder(size_t nodes)
+        : nodes(nodes), out(nodes), in(nodes), contracted(nodes, 0), in_batch(nodes, 0), priority(nodes, 0),
+          deleted_neighbors(nodes, 0), level(nodes, 0), forward_up(nodes), backward_up(nodes) {}
+
+    /// @brief Shortcuts needed to keep every shortest path through node once it is gone
+    void FindShortcuts(int node, WitnessSearch& witness, std::vector<Shortcut>& shortcuts) {
+        shortcuts.clear();
+
+        for (auto& incoming : in[node]) {
+            float max_outgoing = 0;
+            for (auto& outgoing : out[node]) {
+                if (outgoing.node != incoming.node)
+                    max_outgoing = std::max(max_outgoing, outgoing.cost);
+            }
+
+            if (max_outgoing == 0)
+                continue;
+
+            witness.Run(incoming.node, node, incoming.cost + max_outgoing, out[node], out,
+                        [&](int other) { return in_batch[other] != 0; });
+
+            for (auto& outgoing : out[node]) {
+                if (outgoing.node == incoming.node)
+                    continue;
+
+                float via = incoming.cost + outgoing.cost;
+                if (witness.reached(outgoing.node) > via)
+                    shortcuts.push_back({incoming.node, outgoing.node, via});
+            }
+        }
+    }
+
+    void UpdatePriority(int node, WitnessSearch& witness, std::vector<Shortcut>& shortcuts) {
+        FindShortcuts(node, witness, shortcuts);
+
+        // Shortcuts count double, on plateaus of equal weight cells a plain edge difference contracts along rows and
+        // piles every shortcut onto the next cell in line
+        int edge_difference = 2 * (int)shortcuts.size() - (int)(in[node].size() + out[node].size());
+        priority[node] = edge_difference + 2 * deleted_neighbors[node] + level[node];
+    }
+
+    /// @brief Breaks ties between equal priorities, scrambled so neighboring cells on a uniform grid do not all lose to
+    /// the same corner
+    static uint32_t tie_break(int node) {
+        uint32_t hash = node * 0x9e3779b1u;
+
+        return hash ^ (hash >> 16);
+    }
+
+    /// @brief Whether node goes before every neighbor that is still left
+    bool LocalMinimum(int node) {
+        for (auto* edges : {&out[node], &in[node]}) {
+            for (auto& edge : *edges) {
+                if (priority[edge.node] < priority[node] ||
+                    (priority[edge.node] == priority[node] && tie_break(edge.node) < tie_break(node)))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void Upsert(std::vector<Edge>& edges, int node, float cost, int middle) {
+        for (auto& edge : edges) {
+            if (edge.node == node) {
+                if (cost < edge.cost) {
+                    edge.cost = cost;
+                    edge.middle = middle;
+                }
+
+                return;
+            }
+        }
+
+        edges.push_back({node, cost, middle});
+    }
+
+    static void Remove(std::vector<Edge>& edges, int node) {
+        edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const Edge& edge) { return edge.node == node; }),
+                    edges.end());
+    }
+};
+} // namespace
+
+uint64_t ContractionHierarchy::Checksum(const WorldSnapshot& world) {
+    // FNV-1a over the size and every weight
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto add = [&](const void* data, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++) {
+            hash ^= static_cast<const uint8_t*>(data)[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+
+    std::pair<int, int> size = world.get_size();
+    add(&size.first, sizeof(int));
+    add(&size.second, sizeof(int));
+
+    for (int x = 0; x < size.first; x++) {
+        for (int y = 0; y < size.second; y++) {
+            float weight = cell_weight(world, {x, y});
+            add(&weight, sizeof(float));
+        }
+    }
+
+    return hash;
+}
+
+ContractionHierarchy* ContractionHierarchy::Build(const WorldSnapshot& world, int threads) {
+    TRACE_SCOPE("ContractionHierarchy::Build");
+
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    ContractionHierarchy* hierarchy = new ContractionHierarchy();
+    hierarchy->size = world.get_size();
+    hierarchy->checksum = Checksum(world);
+
+    size_t nodes = (size_t)hierarchy->size.first * hierarchy->size.second;
+    hierarchy->weights.resize(nodes);
+
+    Builder builder(nodes);
+    std::vector<int> remaining;
+
+    for (int x = 0; x < hierarchy->size.first; x++) {
+        for (int y = 0; y < hierarchy->size.second; y++) {
+            int node = world.get_position_hashable({x, y});
+            hierarchy->weights[node] = cell_weight(world, {x, y});
+
+            if (!world.is_passable({x, y}))
+                continue;
+
+            remaining.push_back(node);
+
+            Position neighbors[] = {{x + 1, y}, {x - 1, y}, {x, y + 1}, {x, y - 1}};
+            for (auto neighbor : neighbors) {
+                if (!world.in_bounds(neighbor) || !world.is_passable(neighbor))
+                    continue;
+
+                int other = world.get_position_hashable(neighbor);
+                builder.out[node].push_back({other, world.get_weight(neighbor), -1});
+                builder.in[other].push_back({node, world.get_weight(neighbor), -1});
+            }
+        }
+    }
+
+    std::vector<WitnessSearch> witnesses(threads, WitnessSearch(nodes));
+    std::vector<std::vector<Shortcut>> scratch(threads);
+
+    {
+        TRACE_SCOPE("ContractionHierarchy initial priorities");
+
+        parallel_for(remaining.size(), threads,
+                     [&](size_t i, int t) { builder.UpdatePriority(remaining[i], witnesses[t], scratch[t]); });
+    }
+
+    std::vector<int> batch;
+    std::vector<std::vector<Shortcut>> batch_shortcuts;
+    std::vector<int> touched;
+    std::vector<char> is_touched(nodes, 0);
+
+    while (!remaining.empty()) {
+        TRACE_SCOPE("ContractionHierarchy round");
+
+        // Cells that go before all their neighbors are never adjacent, so they can be contracted at the same time as
+        // long as witness searches avoid all of them
+        batch.clear();
+        for (auto node : remaining) {
+            if (builder.LocalMinimum(node))
+                batch.push_back(node);
+        }
+
+        for (auto node : batch)
+            builder.in_batch[node] = 1;
+
+        batch_shortcuts.resize(batch.size());
+        parallel_for(batch.size(), threads,
+                     [&](size_t i, int t) { builder.FindShortcuts(batch[i], witnesses[t], batch_shortcuts[i]); });
+
+        touched.clear();
+        for (size_t i = 0; i < batch.size(); i++) {
+            int node = batch[i];
+
+            // Everything still connected to the cell is contracted after it
+            builder.forward_up[node] = builder.out[node];
+            builder.backward_up[node] = builder.in[node];
+
+            for (auto& shortcut : batch_shortcuts[i]) {
+                Builder::Upsert(builder.out[shortcut.from], shortcut.to, shortcut.cost, node);
+                Builder::Upsert(builder.in[shortcut.to], shortcut.from, shortcut.cost, node);
+            }
+
+            for (auto* edges : {&builder.out[node], &builder.in[node]}) {
+                for (auto& edge : *edges) {
+                    Builder::Remove(builder.out[edge.node], node);
+                    Builder::Remove(builder.in[edge.node], node);
+
+                    builder.deleted_neighbors[edge.node]++;
+                    builder.level[edge.node] = std::max(builder.level[edge.node], builder.level[node] + 1);
+
+                    if (!is_touched[edge.node]) {
+                        is_touched[edge.node] = 1;
+                        touched.push_back(edge.node);
+                    }
+                }
+            }
+
+            builder.out[node].clear();
+            builder.out[node].shrink_to_fit();
+            builder.in[node].clear();
+            builder.in[node].shrink_to_fit();
+
+            builder.contracted[node] = 1;
+            builder.in_batch[node] = 0;
+        }
+
+        remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+                                       [&](int node) { return builder.contracted[node] != 0; }),
+                        remaining.end());
+
+        parallel_for(touched.size(), threads,
+                     [&](size_t i, int t) { builder.UpdatePriority(touched[i], witnesses[t], scratch[t]); });
+
+        for (auto node : touched)
+            is_touched[node] = 0;
+    }
+
+    auto compress = [&](std::vector<std::vector<Builder::Edge>>& lists, std::vector<int>& offsets,
+                        std::vector<Edge>& edges) {
+        offsets.assign(1, 0);
+        for (auto& list : lists) {
+            edges.insert(edges.end(), list.begin(), list.end());
+            offsets.push_back(edges.size());
+        }
+    };
+
+    compress(builder.forward_up, hierarchy->forward_offsets, hierarchy->forward_edges);
+    compress(builder.backward_up, hierarchy->backward_offsets, hierarchy->backward_edges);
+
+    return hierarchy;
+}
+
+std::string ContractionHierarchy::SidecarFor(const std::string& map_filename) {
+    return map_filename + ".ch";
+}
+
+bool ContractionHierarchy::Save(const char* filename) {
+    TRACE_SCOPE("ContractionHierarchy::Save");
+
+    uint32_t header[] = {SIDECAR_MAGIC, (uint32_t)size.first, (uint32_t)size.second, (uint32_t)checksum,
+                         (uint32_t)(checksum >> 32), (uint32_t)forward_edges.size(), (uint32_t)backward_edges.size()};
+
+    std::vector<char> buffer;
+    auto append = [&](const void* data, size_t bytes) {
+        buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + bytes);
+    };
+
+    append(header, sizeof(header));
+    append(forward_offsets.data(), forward_offsets.size() * sizeof(int));
+    append(forward_edges.data(), forward_edges.size() * sizeof(Edge));
+    append(backward_offsets.data(), backward_offsets.size() * sizeof(int));
+    append(backward_edges.data(), backward_edges.size() * sizeof(Edge));
+
+    std::string temp_filename = std::string(filename) + ".tmp";
+    std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+
+        return false;
+    }
+
+    file.write(buffer.data(), buffer.size());
+    file.close();
+
+    if (!file || !replace_file(temp_filename, filename)) {
+        std::cerr << "Error writing " << filename << std::endl;
+        std::remove(temp_filename.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+ContractionHierarchy* ContractionHierarchy::Load(const char* filename, const WorldSnapshot& world) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open())
+        return nullptr;
+
+    TRACE_SCOPE("ContractionHierarchy::Load");
+
+    std::vector<char> buffer(file.tellg());
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+    file.close();
+
+    uint32_t header[7];
+    if (buffer.size() < sizeof(header))
+        return nullptr;
+    memcpy(header, buffer.data(), sizeof(header));
+
+    std::pair<int, int> size = world.get_size();
+    uint64_t checksum = header[3] | (uint64_t)header[4] << 32;
+    size_t nodes = (size_t)size.first * size.second;
+    size_t expected = sizeof(header) + 2 * (nodes + 1) * sizeof(int) + ((size_t)header[5] + header[6]) * sizeof(Edge);
+
+    if (header[0] != SIDECAR_MAGIC || (int)header[1] != size.first || (int)header[2] != size.second ||
+        buffer.size() != expected || checksum != Checksum(world))
+        return nullptr;
+
+    ContractionHierarchy* hierarchy = new ContractionHierarchy();
+    hierarchy->size = size;
+    hierarchy->checksum = checksum;
+
+    size_t pos = sizeof(header);
+    auto take = [&](void* data, size_t bytes) {
+        memcpy(data, buffer.data() + pos, bytes);
+        pos += bytes;
+    };
+
+    hierarchy->forward_offsets.resize(nodes + 1);
+    hierarchy->forward_edges.resize(header[5]);
+    hierarchy->backward_offsets.resize(nodes + 1);
+    hierarchy->backward_edges.resize(header[6]);
+    take(hierarchy->forward_offsets.data(), (nodes + 1) * sizeof(int));
+    take(hierarchy->forward_edges.data(), header[5] * sizeof(Edge));
+    take(hierarchy->backward_offsets.data(), (nodes + 1) * sizeof(int));
+    take(hierarchy->backward_edges.data(), header[6] * sizeof(Edge));
+
+    hierarchy->weights.resize(nodes);
+    for (int x = 0; x < size.first; x++) {
+        for (int y = 0; y < size.second; y++)
+            hierarchy->weights[world.get_position_hashable({x, y})] = cell_weight(world, {x, y});
+    }
+
+    return hierarchy;
+}
+
+ContractionHierarchy* ContractionHierarchy::LoadOrBuild(const char* map_filename, const WorldSnapshot& world,
+                                                        int threads) {
+    if (map_filename == nullptr || map_filename[0] == '\0')
+        return Build(world, threads);
+
+    std::string sidecar = SidecarFor(map_filename);
+
+    ContractionHierarchy* hierarchy = Load(sidecar.c_str(), world);
+    if (hierarchy != nullptr)
+        return hierarchy;
+
+    hierarchy = Build(world, threads);
+    hierarchy->Save(sidecar.c_str());
+
+    return hierarchy;
+}
+
+std::pair<int, int> ContractionHierarchy::get_size() const {
+    return size;
+}
+
+size_t ContractionHierarchy::edge_count() const {
+    return forward_edges.size() + backward_edges.size();
+}
+
+ContractionHierarchyQuery::ContractionHierarchyQuery(const ContractionHierarchy* hierarchy) : hierarchy(hierarchy) {
+    size_t nodes = hierarchy->weights.size();
+
+    for (auto* side : {&forward, &backward}) {
+        side->cost.resize(nodes);
+        side->parent.resize(nodes);
+        side->parent_edge.resize(nodes);
+        side->stamp.assign(nodes, 0);
+    }
+}
+
+const ContractionHierarchy* ContractionHierarchyQuery::get_hierarchy() const {
+    return hierarchy;
+}
+
+bool ContractionHierarchyQuery::Reached(Side& side, int node) {
+    return side.stamp[node] == query_stamp;
+}
+
+void ContractionHierarchyQuery::Reach(Side& side, int node, float cost, int parent, int parent_edge) {
+    if (Reached(side, node) && side.cost[node] <= cost)
+        return;
+
+    side.cost[node] = cost;
+    side.parent[node] = parent;
+    side.parent_edge[node] = parent_edge;
+    side.stamp[node] = query_stamp;
+    side.open.push({cost, node});
+}
+
+void ContractionHierarchyQuery::Unpack(int from, const ContractionHierarchy::Edge& edge,
+                                       std::vector<Position>& cells) {
+    int height = hierarchy->size.second;
+
+    // (from, to, middle), the top is always the earliest part of the path still packed
+    struct Packed {
+        int from;
+        int to;
+        int middle;
+    };
+    std::vector<Packed> stack = {{from, edge.node, edge.middle}};
+
+    while (!stack.empty()) {
+        Packed packed = stack.back();
+        stack.pop_back();
+
+        if (packed.middle == -1) {
+            cells.push_back({packed.to / height, packed.to % height});
+
+            continue;
+        }
+
+        // Both halves were recorded on the skipped cell when it was contracted
+        int middle = packed.middle;
+        const ContractionHierarchy::Edge* first = nullptr;
+        const ContractionHierarchy::Edge* second = nullptr;
+
+        for (int i = hierarchy->backward_offsets[middle]; i < hierarchy->backward_offsets[middle + 1]; i++) {
+            if (hierarchy->backward_edges[i].node == packed.from)
+                first = &hierarchy->backward_edges[i];
+        }
+        for (int i = hierarchy->forward_offsets[middle]; i < hierarchy->forward_offsets[middle + 1]; i++) {
+            if (hierarchy->forward_edges[i].node == packed.to)
+                second = &hierarchy->forward_edges[i];
+        }
+
+        if (first == nullptr || second == nullptr) {
+            std::cerr << "Contraction hierarchy is missing the halves of a shortcut" << std::endl;
+
+            return;
+        }
+
+        stack.push_back({middle, packed.to, second->middle});
+        stack.push_back({packed.from, middle, first->middle});
+    }
+}
+
+float ContractionHierarchyQuery::Route(Position from, Position to, std::vector<Position>* path) {
+    last_settled = 0;
+
+    if (path != nullptr)
+        path->clear();
+
+    std::pair<int, int> size = hierarchy->size;
+    auto in_bounds = [&](Position pos) {
+        return pos.first >= 0 && pos.first < size.first && pos.second >= 0 && pos.second < size.second;
+    };
+
+    if (!in_bounds(from) || !in_bounds(to))
+        return INFINITE_COST;
+
+    if (from == to) {
+        if (path != nullptr)
+            path->push_back(from);
+
+        return 0;
+    }
+
+    int source = from.first * size.second + from.second;
+    int target = to.first * size.second + to.second;
+    const std::vector<float>& weights = hierarchy->weights;
+
+    if (std::isinf(weights[target]))
+        return INFINITE_COST;
+
+    if (++query_stamp == 0) {
+        // Wrapped around, old stamps could match again
+        for (auto* side : {&forward, &backward})
+            std::fill(side->stamp.begin(), side->stamp.end(), 0);
+        query_stamp = 1;
+    }
+
+    for (auto* side : {&forward, &backward}) {
+        while (!side->open.empty())
+            side->open.pop();
+    }
+
+    // Like PathFinder, a start on an impassable cell may still step off it
+    if (!std::isinf(weights[source])) {
+        Reach(forward, source, 0, -1, -1);
+    } else {
+        Position neighbors[] = {{from.first + 1, from.second},
+                                {from.first - 1, from.second},
+                                {from.first, from.second + 1},
+                                {from.first, from.second - 1}};
+
+        for (auto neighbor : neighbors) {
+            int node = neighbor.first * size.second + neighbor.second;
+            if (in_bounds(neighbor) && !std::isinf(weights[node]))
+                Reach(forward, node, weights[node], -1, -1);
+        }
+    }
+
+    Reach(backward, target, 0, -1, -1);
+
+    float best = INFINITE_COST;
+    int meeting = -1;
+
+    while (true) {
+        float forward_top = forward.open.empty() ? INFINITE_COST : forward.open.top().first;
+        float backward_top = backward.open.empty() ? INFINITE_COST : backward.open.top().first;
+
+        // Neither side can still improve on best
+        if (std::min(forward_top, backward_top) >= best)
+            break;
+
+        bool forwards = forward_top <= backward_top;
+        Side& side = forwards ? forward : backward;
+        Side& other = forwards ? backward : forward;
+
+        Side::Entry entry = side.open.top();
+        side.open.pop();
+
+        int node = entry.second;
+        if (entry.first > side.cost[node])
+            continue;
+
+        last_settled++;
+
+        if (Reached(other, node) && entry.first + other.cost[node] < best) {
+            best = entry.first + other.cost[node];
+            meeting = node;
+        }
+
+        const std::vector<int>& offsets = forwards ? hierarchy->forward_offsets : hierarchy->backward_offsets;
+        const std::vector<ContractionHierarchy::Edge>& edges =
+            forwards ? hierarchy->forward_edges : hierarchy->backward_edges;
+
+        for (int i = offsets[node]; i < offsets[node + 1]; i++)
+            Reach(side, edges[i].node, entry.first + edges[i].cost, node, i);
+    }
+
+    if (meeting == -1 || path == nullptr)
+        return best;
+
+    // Forward half, collected from the meeting cell back to the start
+    std::vector<int> forward_chain;
+    for (int node = meeting; forward.parent[node] != -1; node = forward.parent[node])
+        forward_chain.push_back(node);
+
+    int first = forward_chain.empty() ? meeting : forward.parent[forward_chain.back()];
+    path->push_back(from);
+    if (first != source)
+        path->push_back({first / size.second, first % size.second});
+
+    for (auto node = forward_chain.rbegin(); node != forward_chain.rend(); node++)
+        Unpack(forward.parent[*node], hierarchy->forward_edges[forward.parent_edge[*node]], *path);
+
+    // Backward half, every edge on it points from the cell nearer the start to its parent
+    for (int node = meeting; backward.parent[node] != -1; node = backward.parent[node]) {
+        ContractionHierarchy::Edge edge = hierarchy->backward_edges[backward.parent_edge[node]];
+        edge.node = backward.parent[node];
+        Unpack(node, edge, *path);
+    }
+
+    return best;
+}
+
+size_t ContractionHierarchyQuery::settled() {
+    return last_settled;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "WorldSnapshot.h"
+
+/// @brief Contraction hierarchy over the grid graph of a world that will not change, trading a preprocessing pass for
+/// queries that settle a few hundred cells instead of searching the whole map
+///
+/// Cells are contracted from least to most important, each one replaced by shortcuts between its neighbors wherever it
+/// was on their only shortest path. Independent sets of cells are contracted in parallel. What is left is an upward
+/// graph per direction that a bidirectional search only ever climbs, with every shortcut remembering the cell it
+/// skipped so paths can be unpacked back into cells. Moving into a cell costs that cell's weight, so the graph is
+/// directed. Impassable cells are left out, like PathFinder they can only be started from.
+class ContractionHierarchy {
+  public:
+    struct Edge {
+        /// @brief The other end, always a cell contracted later
+        int node;
+        float cost;
+        /// @brief Cell the shortcut skips, -1 for a move between neighboring cells
+        int middle;
+    };
+
+  private:
+    std::pair<int, int> size;
+    /// @brief Identifies the weights and passability the hierarchy was built from, so a stale sidecar is never used
+    uint64_t checksum;
+
+    // Compressed rows, the edges of cell i are [offsets[i], offsets[i + 1])
+    std::vector<int> forward_offsets;
+    std::vector<Edge> forward_edges;
+    std::vector<int> backward_offsets;
+    std::vector<Edge> backward_edges;
+
+    /// @brief Taken from the world on build and load, not saved, for queries starting on impassable cells. Infinity
+    /// for impassable cells.
+    std::vector<float> weights;
+
+    ContractionHierarchy() {}
+
+    friend class ContractionHierarchyQuery;
+
+  public:
+    static uint64_t Checksum(const WorldSnapshot& world);
+
+    /// @param threads 0 for one per hardware thread
+    static ContractionHierarchy* Build(const WorldSnapshot& world, int threads = 0);
+    /// @return nullptr if the file is missing, damaged or was built from different weights
+    static ContractionHierarchy* Load(const char* filename, const WorldSnapshot& world);
+    /// @brief Loads the sidecar next to the map, building and saving it first if it is missing or stale
+    static ContractionHierarchy* LoadOrBuild(const char* map_filename, const WorldSnapshot& world, int threads = 0);
+
+    /// @brief Writes the hierarchy in one go to a temporary file which then replaces filename
+    bool Save(const char* filename);
+
+    static std::string SidecarFor(const std::string& map_filename);
+
+    std::pair<int, int> get_size() const;
+    size_t edge_count() const;
+};
+
+/// @brief Answers queries on a hierarchy, holds per query scratch space so keep one per thread
+class ContractionHierarchyQuery {
+  private:
+    const ContractionHierarchy* hierarchy;
+
+    struct Side {
+        std::vector<float> cost;
+        /// @brief Node the best edge into each node came from and that edge's index
+        std::vector<int> parent;
+        std::vector<int> parent_edge;
+        /// @brief Entries are only valid where stamp matches the current query, so nothing is cleared between them
+        std::vector<uint32_t> stamp;
+
+        typedef std::pair<float, int> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    };
+    Side forward;
+    Side backward;
+    uint32_t query_stamp = 0;
+
+    size_t last_settled = 0;
+
+    void Reach(Side& side, int node, float cost, int parent, int parent_edge);
+    bool Reached(Side& side, int node);
+    /// @brief Appends the cells an edge passes through after from, ending with the edge's end
+    void Unpack(int from, const ContractionHierarchy::Edge& edge, std::vector<Position>& cells);
+
+  public:
+    ContractionHierarchyQuery(const ContractionHierarchy* hierarchy);
+
+    const ContractionHierarchy* get_hierarchy() const;
+
+    /// @param path If not nullptr, filled with every cell from from to to inclusive
+    /// @return Cost of the cheapest path, infinity if there is none
+    float Route(Position from, Position to, std::vector<Position>* path = nullptr);
+
+    /// @brief Nodes settled by the last Route, a measure of query effort
+    size_t settled();
+};
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "DeltaStepping.h"
+#include "Trace.h"
+
+namespace {
+const float INFINITE_COST = std::numeric_limits<float>::infinity();
+
+/// @brief Cells handed to a thread at a time
+const size_t RELAX_CHUNK = 256;
+} // namespace
+
+DeltaStepping::DeltaStepping(std::shared_ptr<const WorldSnapshot> snapshot, float delta, int threads)
+    : snapshot(snapshot), pool(threads) {
+    std::pair<int, int> size = snapshot->get_size();
+    height = size.second;
+
+    size_t cells = (size_t)size.first * size.second;
+    cost = std::vector<std::atomic<float>>(cells);
+    weights.resize(cells);
+    frontier_stamp.assign(cells, 0);
+    requests.resize(pool.thread_count());
+
+    double passable_sum = 0;
+    size_t passable_count = 0;
+
+    for (int x = 0; x < size.first; x++) {
+        for (int y = 0; y < size.second; y++) {
+            float weight = snapshot->is_passable({x, y}) ? snapshot->get_weight({x, y}) : INFINITE_COST;
+            weights[snapshot->get_position_hashable({x, y})] = weight;
+
+            if (!std::isinf(weight)) {
+                passable_sum += weight;
+                passable_count++;
+            }
+        }
+    }
+
+    // The mean weight keeps most moves light while still settling several cost levels per bucket
+    if (delta <= 0)
+        delta = passable_count > 0 ? passable_sum / passable_count : 1;
+    this->delta = delta;
+}
+
+size_t DeltaStepping::bucket_of(float value) {
+    return (size_t)(value / delta);
+}
+
+void DeltaStepping::Relax(int from, bool heavy, std::vector<std::pair<size_t, int>>& out) {
+    float from_cost = cost[from].load(std::memory_order_relaxed);
+    int x = from / height;
+    int y = from % height;
+    int width = weights.size() / height;
+
+    int neighbors[] = {x + 1 < width ? from + height : -1, x > 0 ? from - height : -1,
+                       y + 1 < height ? from + 1 : -1, y > 0 ? from - 1 : -1};
+
+    for (int neighbor : neighbors) {
+        if (neighbor == -1)
+            continue;
+
+        float weight = weights[neighbor];
+        if (std::isinf(weight) || (weight > delta) != heavy)
+            continue;
+
+        float next = from_cost + weight;
+        float current = cost[neighbor].load(std::memory_order_relaxed);
+
+        // Atomic min, retried only while another thread keeps lowering it to something still above next
+        while (next < current) {
+            if (cost[neighbor].compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+                out.push_back({bucket_of(next), neighbor});
+                break;
+            }
+        }
+    }
+}
+
+void DeltaStepping::RelaxAll(const std::vector<int>& frontier, bool heavy) {
+    last_relaxed += frontier.size();
+
+    if (frontier.size() < PARALLEL_FRONTIER) {
+        for (int node : frontier)
+            Relax(node, heavy, requests[0]);
+    } else {
+        pool.ParallelFor(frontier.size(), RELAX_CHUNK, [&](size_t begin, size_t end, int worker) {
+            for (size_t i = begin; i < end; i++)
+                Relax(frontier[i], heavy, requests[worker]);
+        });
+    }
+
+    for (auto& thread_requests : requests) {
+        for (auto& request : thread_requests) {
+            if (request.first >= buckets.size())
+                buckets.resize(request.first + 1);
+
+            buckets[request.first].push_back(request.second);
+        }
+
+        thread_requests.clear();
+    }
+}
+
+void DeltaStepping::Run(Position source, const std::vector<Position>& targets) {
+    TRACE_SCOPE("DeltaStepping::Run");
+
+    this->source = source;
+    last_relaxed = 0;
+
+    pool.ParallelFor(cost.size(), 1 << 16, [&](size_t begin, size_t end, int /*worker*/) {
+        for (size_t i = begin; i < end; i++)
+            cost[i].store(INFINITE_COST, std::memory_order_relaxed);
+    });
+
+    for (auto& bucket : buckets)
+        bucket.clear();
+
+    auto seed = [&](Position pos, float value) {
+        int node = snapshot->get_position_hashable(pos);
+        cost[node].store(value, std::memory_order_relaxed);
+
+        size_t bucket = bucket_of(value);
+        if (bucket >= buckets.size())
+            buckets.resize(bucket + 1);
+        buckets[bucket].push_back(node);
+    };
+
+    if (snapshot->is_passable(source)) {
+        seed(source, 0);
+    } else {
+        Position neighbors[] = {{source.first + 1, source.second},
+                                {source.first - 1, source.second},
+                                {source.first, source.second + 1},
+                                {source.first, source.second - 1}};
+
+        for (auto neighbor : neighbors) {
+            if (snapshot->in_bounds(neighbor) && snapshot->is_passable(neighbor))
+                seed(neighbor, snapshot->get_weight(neighbor));
+        }
+    }
+
+    std::vector<int> target_nodes;
+    for (auto target : targets) {
+        if (snapshot->in_bounds(target) && target != source)
+            target_nodes.push_back(snapshot->get_position_hashable(target));
+    }
+
+    std::vector<int> frontier;
+    std::vector<int> settled;
+
+    for (size_t i = 0; i < buckets.size(); i++) {
+        settled.clear();
+
+        while (!buckets[i].empty()) {
+            frontier.clear();
+            frontier.swap(buckets[i]);
+
+            // Drop cells queued more than once and stale entries of cells lowered into an earlier bucket since, what is
+            // left is exactly the cells whose cost lies in this bucket
+            phase++;
+            frontier.erase(std::remove_if(frontier.begin(), frontier.end(),
+                                          [&](int node) {
+                                              if (frontier_stamp[node] == phase ||
+                                                  bucket_of(cost[node].load(std::memory_order_relaxed)) != i)
+                                                  return true;
+
+                                              frontier_stamp[node] = phase;
+                                              return false;
+                                          }),
+                           frontier.end());
+
+            settled.insert(settled.end(), frontier.begin(), frontier.end());
+            RelaxAll(frontier, false);
+        }
+
+        // Heavy moves always leave the bucket, so they only need relaxing once from each settled cell
+        phase++;
+        settled.erase(std::remove_if(settled.begin(), settled.end(),
+                                     [&](int node) {
+                                         if (frontier_stamp[node] == phase)
+                                             return true;
+
+                                         frontier_stamp[node] = phase;
+                                         return false;
+                                     }),
+                      settled.end());
+        RelaxAll(settled, true);
+
+        if (!target_nodes.empty()) {
+            bool all_settled = true;
+            for (int node : target_nodes) {
+                float target_cost = cost[node].load(std::memory_order_relaxed);
+                all_settled = all_settled && !std::isinf(target_cost) && bucket_of(target_cost) <= i;
+            }
+
+            if (all_settled)
+                break;
+        }
+    }
+}
+
+float DeltaStepping::get_cost(Position pos) {
+    if (pos == source)
+        return 0;
+
+    return cost[snapshot->get_position_hashable(pos)].load(std::memory_order_relaxed);
+}
+
+std::vector<Position> DeltaStepping::get_path(Position to) {
+    std::vector<Position> path;
+
+    if (!snapshot->in_bounds(to) || std::isinf(get_cost(to)))
+        return path;
+
+    path.push_back(to);
+
+    // Bounded by the cell count, so zero weight cells can not send it in circles
+    for (size_t steps = 0; path.back() != source && steps < cost.size(); steps++) {
+        Position current = path.back();
+        float current_cost = get_cost(current);
+        float weight = snapshot->get_weight(current);
+
+        Position neighbors[] = {{current.first + 1, current.second},
+                                {current.first - 1, current.second},
+                                {current.first, current.second + 1},
+                                {current.first, current.second - 1}};
+
+        bool found = false;
+        for (auto neighbor : neighbors) {
+            if (!snapshot->in_bounds(neighbor))
+                continue;
+
+            // The source itself may be impassable and so never relaxed from
+            if (neighbor == source ? current_cost == weight : get_cost(neighbor) + weight == current_cost) {
+                path.push_back(neighbor);
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            return {};
+    }
+
+    std::reverse(path.begin(), path.end());
+
+    return path;
+}
+
+float DeltaStepping::get_delta() {
+    return delta;
+}
+
+int DeltaStepping::thread_count() {
+    return pool.thread_count();
+}
+
+size_t DeltaStepping::relaxed() {
+    return last_relaxed;
+}
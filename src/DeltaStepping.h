@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "WorldSnapshot.h"
+#include "WorkerPool.h"
+
+/// @brief Parallel single source shortest paths over the grid of a snapshot (Meyer and Sanders' delta-stepping)
+///
+/// Tentative costs sit in buckets delta wide. The lowest bucket is settled by relaxing its light moves (into cells
+/// weighing at most delta) on every thread at once, over and over until the bucket stays empty, then the heavy moves
+/// out of everything it settled are relaxed once. Costs are lowered with an atomic compare and swap, so threads never
+/// wait on each other inside a phase. Small frontiers are relaxed on the calling thread, waking the pool for them would
+/// cost more than it saves. The resulting costs are exactly Dijkstra's, each is the cost of an actual path.
+class DeltaStepping {
+  private:
+    std::shared_ptr<const WorldSnapshot> snapshot;
+    int height;
+    float delta;
+    Position source = {0, 0};
+
+    WorkerPool pool;
+
+    std::vector<std::atomic<float>> cost;
+    /// @brief Per cell weight, infinity where impassable, cached flat so relaxing does not go through the chunks
+    std::vector<float> weights;
+
+    std::vector<std::vector<int>> buckets;
+    /// @brief Requests collected by each thread during a phase, merged into buckets after it
+    std::vector<std::vector<std::pair<size_t, int>>> requests;
+    /// @brief Phase a cell was last taken into a frontier in, so a cell queued twice is only relaxed once
+    std::vector<uint32_t> frontier_stamp;
+    uint32_t phase = 0;
+
+    size_t last_relaxed = 0;
+
+    size_t bucket_of(float value);
+    void Relax(int from, bool heavy, std::vector<std::pair<size_t, int>>& out);
+    void RelaxAll(const std::vector<int>& frontier, bool heavy);
+
+  public:
+    /// @brief Frontiers smaller than this are relaxed on the calling thread
+    static const size_t PARALLEL_FRONTIER = 512;
+
+    /// @param delta Bucket width, 0 to pick one from the weights
+    /// @param threads 0 for one per hardware thread
+    DeltaStepping(std::shared_ptr<const WorldSnapshot> snapshot, float delta = 0, int threads = 0);
+
+    /// @brief Costs from source to every cell, stopping early once every cell in targets is settled. A source on an
+    /// impassable cell may step off it, like in PathFinder.
+    void Run(Position source, const std::vector<Position>& targets = {});
+
+    /// @return Cost of the cheapest path from the last source, infinity if there is none
+    float get_cost(Position pos);
+    /// @brief Walks back from to along cells whose cost is exactly their predecessor's plus their weight
+    /// @return Every cell from the last source to to inclusive, empty if to was not reached
+    std::vector<Position> get_path(Position to);
+
+    float get_delta();
+    int thread_count();
+    /// @brief Cells relaxed by the last Run, counting a cell again every time it was relaxed
+    size_t relaxed();
+};
@@ -0,0 +1,79 @@
+#include <limits>
+#include <map>
+
+#include "DeltaSteppingPathFinder.h"
+#include "Trace.h"
+
+DeltaSteppingPathFinder::DeltaSteppingPathFinder(World* world, SearchContext* context, float delta, int threads)
+    : PathFinder(world, Dijkstra::Heuristic, context), engine(snapshot, delta, threads) {}
+
+DeltaSteppingPathFinder::DeltaSteppingPathFinder(std::shared_ptr<const WorldSnapshot> snapshot,
+                                                 SearchContext* context, float delta, int threads)
+    : PathFinder(snapshot, Dijkstra::Heuristic, context), engine(snapshot, delta, threads) {}
+
+DeltaStepping& DeltaSteppingPathFinder::get_engine() {
+    return engine;
+}
+
+void DeltaSteppingPathFinder::Step() {
+    if (completed() || failed())
+        return;
+
+    TRACE_SCOPE("DeltaSteppingPathFinder::Step");
+
+    std::vector<Position> stops = {snapshot->get_spawn()};
+    stops.insert(stops.end(), snapshot->get_goals().begin(), snapshot->get_goals().end());
+    stops.push_back(snapshot->get_destination());
+
+    // Every stop but the destination is searched from once, stopping as soon as every other stop is settled
+    std::map<std::pair<Position, Position>, float> legs;
+    Position last_source = snapshot->get_destination();
+
+    for (size_t i = 0; i + 1 < stops.size(); i++) {
+        engine.Run(stops[i], stops);
+        search_stats.nodes_expanded += engine.relaxed();
+        last_source = stops[i];
+
+        for (auto stop : stops)
+            legs[{stops[i], stop}] = engine.get_cost(stop);
+    }
+
+    int best = -1;
+    float best_total = std::numeric_limits<float>::infinity();
+
+    for (size_t i = 0; i < goal_paths.size(); i++) {
+        float total = 0;
+        for (size_t leg = 0; leg + 1 < goal_paths[i].size(); leg++)
+            total += legs[{goal_paths[i][leg], goal_paths[i][leg + 1]}];
+
+        if (total < best_total) {
+            best_total = total;
+            best = i;
+        }
+    }
+
+    if (best == -1) {
+        // Nothing reaches the destination, leave failed() to report it
+        for (size_t i = 0; i < goal_paths.size(); i++)
+            context->open_remove_goal_path(i);
+
+        return;
+    }
+
+    std::vector<Position> path;
+    for (size_t leg = 0; leg + 1 < goal_paths[best].size(); leg++) {
+        Position from = goal_paths[best][leg];
+        Position to = goal_paths[best][leg + 1];
+
+        if (from != last_source) {
+            engine.Run(from, {to});
+            search_stats.nodes_expanded += engine.relaxed();
+            last_source = from;
+        }
+
+        std::vector<Position> leg_path = engine.get_path(to);
+        path.insert(path.end(), path.empty() ? leg_path.begin() : leg_path.begin() + 1, leg_path.end());
+    }
+
+    SetSolution(best, path, best_total);
+}
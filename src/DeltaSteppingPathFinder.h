@@ -0,0 +1,24 @@
+#pragma once
+
+#include "DeltaStepping.h"
+#include "Pathfinder.h"
+
+/// @brief Stands in for PathFinder, answering the whole search in one Step with parallel delta-stepping searches
+///
+/// One search from spawn and from every goal gives the cost of every leg, then the legs of the cheapest goal order are
+/// searched again to walk their paths back. Same costs as Dijkstra::Heuristic, only spread over threads.
+class DeltaSteppingPathFinder : public PathFinder {
+  private:
+    DeltaStepping engine;
+
+  public:
+    /// @param delta Bucket width, 0 to pick one from the weights
+    /// @param threads 0 for one per hardware thread
+    DeltaSteppingPathFinder(World* world, SearchContext* context = nullptr, float delta = 0, int threads = 0);
+    DeltaSteppingPathFinder(std::shared_ptr<const WorldSnapshot> snapshot, SearchContext* context = nullptr,
+                            float delta = 0, int threads = 0);
+
+    DeltaStepping& get_engine();
+
+    void Step() override;
+};
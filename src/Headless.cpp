@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "ContractionHierarchy.h"
+#include "DeltaSteppingPathFinder.h"
+#include "Headless.h"
+#include "HierarchyPathFinder.h"
+#include "Json.h"
+#include "MultiAgentPlanner.h"
+#include "Pathfinder.h"
+#include "SearchTrace.h"
+#include "Trace.h"
+#include "World.h"
+#include "WorldGenerator.h"
+
+/// @brief Parses "weight:share,weight:share,..."
+static bool parse_terrain_mix(const std::string& text, std::vector<std::pair<float, float>>& terrain_mix) {
+    terrain_mix.clear();
+
+    // Both halves have to be finite numbers with nothing after them, strtof stops quietly at the first character it can
+    // not read
+    auto parse_float = [](const std::string& part, float& value) {
+        char* end;
+        value = strtof(part.c_str(), &end);
+        return !part.empty() && *end == '\0' && std::isfinite(value);
+    };
+
+    std::stringstream stream(text);
+    std::string entry;
+    while (std::getline(stream, entry, ',')) {
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos)
+            return false;
+
+        float weight, share;
+        if (!parse_float(entry.substr(0, colon), weight) || !parse_float(entry.substr(colon + 1), share) || share < 0)
+            return false;
+
+        terrain_mix.push_back({weight, share});
+    }
+
+    return !terrain_mix.empty();
+}
+
+/// @brief Moves agent_count random agents at once and reports how many were planned per second
+static int run_agents(World* world, int agent_count, uint64_t seed, MultiAgentOptions options, bool stats_json) {
+    std::shared_ptr<const WorldSnapshot> snapshot = world->snapshot();
+    std::vector<AgentTask> tasks = MultiAgentPlanner::RandomTasks(*snapshot, agent_count, seed);
+
+    auto start = std::chrono::steady_clock::now();
+
+    MultiAgentPlanner planner(snapshot, tasks, options);
+    planner.Run();
+
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double agents_per_second = tasks.size() / (elapsed / 1000.0);
+    MultiAgentStats stats = planner.stats();
+    size_t conflicts = planner.CountConflicts();
+
+    if (stats_json) {
+        std::cout << "{\"agents\": " << tasks.size() << ", \"arrived\": " << planner.arrived_count()
+                  << ", \"ms\": " << elapsed << ", \"agents_per_second\": " << agents_per_second
+                  << ", \"makespan\": " << planner.makespan() << ", \"total_cost\": " << planner.get_total_cost()
+                  << ", \"conflicts\": " << conflicts << ", \"rounds\": " << stats.rounds
+                  << ", \"waves\": " << stats.waves << ", \"rejected\": " << stats.rejected
+                  << ", \"pinned\": " << stats.pinned << ", \"expansions\": " << stats.expansions
+                  << ", \"heuristic_grids\": " << stats.heuristic_grids << ", \"heuristic_ms\": " << stats.heuristic_ms
+                  << ", \"planning_ms\": " << stats.planning_ms << "}" << std::endl;
+    } else {
+        std::cout << "Planned " << tasks.size() << " agents in " << elapsed << " ms (" << agents_per_second
+                  << " agents/s, heuristics " << stats.heuristic_ms << " ms), " << planner.arrived_count()
+                  << " arrived after " << planner.makespan() << " steps with total cost " << planner.get_total_cost()
+                  << std::endl;
+        std::cout << stats.rounds << " rounds, " << stats.waves << " waves, " << stats.rejected << " plans rejected, "
+                  << stats.pinned << " pinned, " << stats.expansions << " expansions, " << conflicts << " conflicts"
+                  << std::endl;
+    }
+
+    return planner.all_arrived() && conflicts == 0 ? 0 : 2;
+}
+
+/// @brief Times delta-stepping solves on 1, 2, 4, ... threads up to max_threads, against the single threaded time
+static void report_speedup(World* world, float delta, int max_threads) {
+    if (max_threads <= 0)
+        max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    double single = 0;
+    for (int threads : thread_counts) {
+        DeltaSteppingPathFinder pathfinder(world, nullptr, delta, threads);
+
+        auto start = std::chrono::steady_clock::now();
+        while (!pathfinder.completed() && !pathfinder.failed())
+            pathfinder.Step();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (threads == 1)
+            single = elapsed;
+
+        std::cout << threads << " threads: " << elapsed << " ms, " << single / elapsed << "x, cost "
+                  << pathfinder.get_best_cost() << std::endl;
+    }
+}
+
+int RunHeadless(int argc, char** argv) {
+    const char* map_file = nullptr;
+    std::string algorithm = "astar";
+    bool stats_json = false;
+    const char* trace_file = nullptr;
+    const char* record_file = nullptr;
+    const char* generate_file = nullptr;
+    SearchOptions search_options;
+    WorldGeneratorConfig generator_config;
+    std::vector<std::pair<Position, float>> edits;
+    bool compact = false;
+    bool persist = false;
+    int threads = 0;
+    float delta = 0;
+    bool speedup = false;
+    int agent_count = 0;
+    MultiAgentOptions agent_options;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            map_file = argv[++i];
+        } else if (strcmp(argv[i], "--algorithm") == 0 && i + 1 < argc) {
+            algorithm = argv[++i];
+        } else if (strcmp(argv[i], "--stats-json") == 0) {
+            stats_json = true;
+        } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "exact") == 0) {
+                search_options.mode = SearchMode::Exact;
+            } else if (strcmp(argv[i], "weighted") == 0) {
+                search_options.mode = SearchMode::Weighted;
+            } else if (strcmp(argv[i], "anytime") == 0) {
+                search_options.mode = SearchMode::Anytime;
+            } else {
+                std::cerr << "Unknown mode " << argv[i] << ", expected exact, weighted or anytime" << std::endl;
+
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--epsilon") == 0 && i + 1 < argc) {
+            search_options.epsilon = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--epsilon-step") == 0 && i + 1 < argc) {
+            search_options.epsilon_step = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-prune") == 0) {
+            search_options.prune = false;
+        } else if (strcmp(argv[i], "--set-weight") == 0 && i + 1 < argc) {
+            Position pos;
+            float weight;
+            if (sscanf(argv[++i], "%d,%d,%f", &pos.first, &pos.second, &weight) != 3) {
+                std::cerr << "Expected --set-weight <x>,<y>,<weight>" << std::endl;
+
+                return 1;
+            }
+
+            edits.push_back({pos, weight});
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_file = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) {
+            delta = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--speedup") == 0) {
+            speedup = true;
+        } else if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc) {
+            agent_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            agent_options.window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--execute") == 0 && i + 1 < argc) {
+            agent_options.execute = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (strcmp(argv[i], "--persist") == 0) {
+            persist = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            generate_file = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &generator_config.size.first, &generator_config.size.second) != 2) {
+                std::cerr << "Expected --size <width>x<height>" << std::endl;
+
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            generator_config.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--maze") == 0) {
+            generator_config.maze = true;
+        } else if (strcmp(argv[i], "--braid") == 0 && i + 1 < argc) {
+            generator_config.maze_braid = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--wall-density") == 0 && i + 1 < argc) {
+            generator_config.wall_density = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--goals") == 0 && i + 1 < argc) {
+            generator_config.goal_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--terrain-scale") == 0 && i + 1 < argc) {
+            generator_config.terrain_scale = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--terrain") == 0 && i + 1 < argc) {
+            if (!parse_terrain_mix(argv[++i], generator_config.terrain_mix)) {
+                std::cerr << "Expected --terrain <weight>:<share>,..." << std::endl;
+
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+
+            return 1;
+        }
+    }
+
+    if (trace_file != nullptr)
+        Trace::BeginSession(trace_file);
+
+    if (generate_file != nullptr) {
+        if (!WorldGenerator::Write(generator_config, generate_file)) {
+            Trace::EndSession();
+
+            return 1;
+        }
+
+        std::cout << "Generated " << generator_config.size.first << "x" << generator_config.size.second
+                  << " world to " << generate_file << std::endl;
+
+        if (map_file == nullptr) {
+            Trace::EndSession();
+
+            return 0;
+        }
+    }
+
+    if (map_file == nullptr) {
+        std::cerr << "No map given, use --map <file.dat>" << std::endl;
+
+        return 1;
+    }
+
+    bool hierarchy_query = algorithm == "ch";
+    bool delta_stepping = algorithm == "delta";
+
+    PathfinderHeuristicFn heuristic_fn;
+    if (!hierarchy_query && !delta_stepping && !find_heuristic(algorithm, heuristic_fn)) {
+        std::cerr << "Unknown algorithm " << algorithm << ", expected astar, dijkstra, crow, folly, ch or delta"
+                  << std::endl;
+
+        return 1;
+    }
+
+    // A one-off edit must not change every later run on the map, so edits are only journaled when asked to
+    World* world = new World(map_file, persist);
+
+    // Compaction writes out whatever the world holds, so it goes first unless this run's edits are meant to stay
+    if (compact && !persist)
+        world->Compact();
+
+    for (auto edit : edits) {
+        if (!world->in_bounds(edit.first)) {
+            std::cerr << "Edit at " << edit.first.first << "," << edit.first.second << " is out of bounds" << std::endl;
+
+            delete world;
+
+            return 1;
+        }
+
+        if (!world->set_weight(edit.first, edit.second)) {
+            delete world;
+
+            return 1;
+        }
+    }
+
+    // Runs alongside the search
+    if (compact && persist)
+        world->Compact();
+
+    if (agent_count > 0) {
+        agent_options.threads = threads;
+        int result = run_agents(world, agent_count, generator_config.seed, agent_options, stats_json);
+
+        world->WaitForCompaction();
+        Trace::EndSession();
+        delete world;
+
+        return result;
+    }
+
+    PathFinder* pathfinder;
+    ContractionHierarchy* hierarchy = nullptr;
+
+    if (hierarchy_query) {
+        auto start = std::chrono::steady_clock::now();
+
+        hierarchy = ContractionHierarchy::LoadOrBuild(map_file, *world->snapshot(), threads);
+
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!stats_json)
+            std::cout << "Contraction hierarchy with " << hierarchy->edge_count() << " edges ready in " << elapsed
+                      << " ms" << std::endl;
+
+        pathfinder = new HierarchyPathFinder(world, hierarchy);
+    } else if (delta_stepping) {
+        if (speedup)
+            report_speedup(world, delta, threads);
+
+        pathfinder = new DeltaSteppingPathFinder(world, nullptr, delta, threads);
+    } else {
+        pathfinder = new PathFinder(world, heuristic_fn, nullptr, search_options);
+    }
+
+    SearchTraceRecorder* recorder = nullptr;
+    if (record_file != nullptr) {
+        recorder = new SearchTraceRecorder(*pathfinder->get_snapshot(), map_file, algorithm);
+        pathfinder->set_recorder(recorder);
+    }
+
+    {
+        TRACE_SCOPE("Headless solve");
+
+        float reported_bound = pathfinder->get_suboptimality_bound();
+        while (!pathfinder->completed() && !pathfinder->failed()) {
+            pathfinder->Step();
+
+            // Anytime searches report every improvement as it happens
+            if (!stats_json && search_options.mode == SearchMode::Anytime &&
+                pathfinder->get_suboptimality_bound() != reported_bound) {
+                reported_bound = pathfinder->get_suboptimality_bound();
+                std::cout << "Cost " << pathfinder->get_best_cost() << " within " << reported_bound
+                          << "x of optimal after " << pathfinder->stats().nodes_expanded << " steps" << std::endl;
+            }
+        }
+    }
+
+    world->WaitForCompaction();
+
+    if (recorder != nullptr) {
+        recorder->Finish(pathfinder->completed(), pathfinder->get_best_cost(), pathfinder->get_best_path());
+
+        size_t bytes = recorder->Write(record_file);
+        if (bytes > 0 && !stats_json)
+            std::cout << "Recorded " << recorder->step_count() << " steps to " << record_file << " in " << bytes
+                      << " bytes" << std::endl;
+    }
+
+    Trace::EndSession();
+
+    if (stats_json) {
+        // JSON has no infinity, an unsolved search has no cost or bound
+        std::string bound = pathfinder->has_solution() ? std::to_string(pathfinder->get_suboptimality_bound()) : "null";
+        std::ostringstream cost;
+        if (pathfinder->has_solution())
+            cost << pathfinder->get_best_cost();
+        else
+            cost << "null";
+
+        std::cout << "{\"map\": " << JsonQuote(map_file) << ", \"algorithm\": " << JsonQuote(algorithm)
+                  << ", \"completed\": " << (pathfinder->completed() ? "true" : "false") << ", \"cost\": " << cost.str()
+                  << ", \"suboptimality_bound\": " << bound
+                  << ", \"stats\": " << pathfinder->stats().to_json() << "}" << std::endl;
+    } else if (pathfinder->completed()) {
+        std::cout << "Found path with cost " << pathfinder->get_best_cost() << " in "
+                  << pathfinder->stats().nodes_expanded << " steps" << std::endl;
+    } else {
+        std::cout << "No path found after " << pathfinder->stats().nodes_expanded << " steps" << std::endl;
+    }
+
+    bool completed = pathfinder->completed();
+
+    delete recorder;
+    delete pathfinder;
+    delete hierarchy;
+    delete world;
+
+    return completed ? 0 : 2;
+}
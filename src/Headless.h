@@ -0,0 +1,27 @@
+#pragma once
+
+/// @brief Runs the pathfinder without opening a window, used for benchmarking and scripting
+///
+/// Usage: the_legend_of_alberta --headless --map <file.dat> [--algorithm <name>]
+/// [--mode exact|weighted|anytime] [--epsilon <e>] [--epsilon-step <e>] [--no-prune] [--stats-json]
+/// [--trace <file.json>]
+///
+/// --no-prune searches dead ends and corridors cell by cell, like before they were pruned (see SearchOptions::prune)
+///
+/// --set-weight <x>,<y>,<weight> (repeatable) edits the map for this run only, --persist journals the edits next to
+/// the map so every later load sees them. --compact folds the journal into the map file alongside the search.
+///
+/// --algorithm ch answers from a contraction hierarchy saved next to the map as <file.dat>.ch, built first (on
+/// --threads <n> threads, default all) if it is missing or the map changed since
+///
+/// --algorithm delta searches with parallel delta-stepping on --threads <n> threads with buckets --delta <width> wide
+/// (default the mean weight), --speedup first times it on 1, 2, 4, ... threads up to that many
+///
+/// --agents <n> moves n agents at once from random starts to random goals (placed by --seed) without collisions,
+/// planning --window <steps> ahead (default 16) and replanning every --execute <steps> (default 8) on --threads <n>
+/// threads, and reports agents planned per second
+///
+/// Generate a world first (see WorldGeneratorConfig) with --generate <file.dat> [--size <w>x<h>] [--seed <n>] [--maze]
+/// [--braid <fraction>] [--wall-density <fraction>] [--goals <n>] [--terrain <weight>:<share>,...]
+/// [--terrain-scale <cells>], --map is optional when generating
+int RunHeadless(int argc, char** argv);
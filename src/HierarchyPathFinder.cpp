@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "HierarchyPathFinder.h"
+#include "Trace.h"
+
+HierarchyPathFinder::HierarchyPathFinder(World* world, const ContractionHierarchy* hierarchy, SearchContext* context,
+                                         ContractionHierarchyQuery* query)
+    : HierarchyPathFinder(world != nullptr ? world->snapshot() : nullptr, hierarchy, context, query) {
+    this->world = world;
+}
+
+HierarchyPathFinder::HierarchyPathFinder(std::shared_ptr<const WorldSnapshot> snapshot,
+                                         const ContractionHierarchy* hierarchy, SearchContext* context,
+                                         ContractionHierarchyQuery* query)
+    : PathFinder(snapshot, Dijkstra::Heuristic, context), hierarchy(hierarchy), query(query) {
+    if (query == nullptr) {
+        owned_query.reset(new ContractionHierarchyQuery(hierarchy));
+        this->query = owned_query.get();
+    }
+}
+
+void HierarchyPathFinder::Step() {
+    if (completed() || failed())
+        return;
+
+    TRACE_SCOPE("HierarchyPathFinder::Step");
+
+    // Legs are shared between goal orders, query each pair of stops once
+    std::map<std::pair<Position, Position>, float> legs;
+    auto leg_cost = [&](Position from, Position to) {
+        auto leg = legs.find({from, to});
+        if (leg != legs.end())
+            return leg->second;
+
+        float cost = query->Route(from, to);
+        search_stats.nodes_expanded += query->settled();
+        legs[{from, to}] = cost;
+
+        return cost;
+    };
+
+    int best = -1;
+    float best_total = std::numeric_limits<float>::infinity();
+
+    for (size_t i = 0; i < goal_paths.size(); i++) {
+        float total = 0;
+        for (size_t leg = 0; leg + 1 < goal_paths[i].size(); leg++)
+            total += leg_cost(goal_paths[i][leg], goal_paths[i][leg + 1]);
+
+        if (total < best_total) {
+            best_total = total;
+            best = i;
+        }
+    }
+
+    if (best == -1) {
+        // Nothing reaches the destination, leave failed() to report it
+        for (size_t i = 0; i < goal_paths.size(); i++)
+            context->open_remove_goal_path(i);
+
+        return;
+    }
+
+    std::vector<Position> path;
+    std::vector<Position> leg_path;
+    for (size_t leg = 0; leg + 1 < goal_paths[best].size(); leg++) {
+        query->Route(goal_paths[best][leg], goal_paths[best][leg + 1], &leg_path);
+        path.insert(path.end(), path.empty() ? leg_path.begin() : leg_path.begin() + 1, leg_path.end());
+    }
+
+    SetSolution(best, path, best_total);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ContractionHierarchy.h"
+#include "Pathfinder.h"
+
+/// @brief Stands in for PathFinder, answering the whole search in one Step with contraction hierarchy queries
+///
+/// Every leg between spawn, goals and destination is queried once, then the cheapest goal order is unpacked into
+/// cells. The hierarchy has to be built from the same weights as the world being searched.
+class HierarchyPathFinder : public PathFinder {
+  private:
+    const ContractionHierarchy* hierarchy;
+    /// @brief Either borrowed or owned_query
+    ContractionHierarchyQuery* query;
+    std::unique_ptr<ContractionHierarchyQuery> owned_query;
+
+  public:
+    /// @param query Reused query scratch space for the same hierarchy. If nullptr the PathFinder allocates its own.
+    HierarchyPathFinder(World* world, const ContractionHierarchy* hierarchy, SearchContext* context = nullptr,
+                        ContractionHierarchyQuery* query = nullptr);
+    HierarchyPathFinder(std::shared_ptr<const WorldSnapshot> snapshot, const ContractionHierarchy* hierarchy,
+                        SearchContext* context = nullptr, ContractionHierarchyQuery* query = nullptr);
+
+    void Step() override;
+};
@@ -0,0 +1,366 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#include "Json.h"
+
+class JsonParser {
+  private:
+    const std::string& text;
+    size_t at = 0;
+    std::string error;
+
+    /// @brief Nesting is bounded so a hostile line cannot overflow the stack
+    static const int MAX_DEPTH = 64;
+
+    void SkipSpace() {
+        while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\n' || text[at] == '\r'))
+            at++;
+    }
+
+    bool Fail(const char* message) {
+        if (error.empty())
+            error = std::string(message) + " at column " + std::to_string(at + 1);
+
+        return false;
+    }
+
+    bool Literal(const char* word) {
+        size_t length = std::char_traits<char>::length(word);
+        if (text.compare(at, length, word) != 0)
+            return Fail("Unexpected token");
+
+        at += length;
+
+        return true;
+    }
+
+    static void AppendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += (char)code;
+        } else if (code < 0x800) {
+            out += (char)(0xc0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3f));
+        } else {
+            out += (char)(0xe0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3f));
+            out += (char)(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool ParseString(std::string& out) {
+        // Skip the opening quote
+        at++;
+
+        while (at < text.size()) {
+            char c = text[at++];
+
+            if (c == '"')
+                return true;
+
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+
+            if (at >= text.size())
+                break;
+
+            char escape = text[at++];
+            switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                out += escape;
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                if (at + 4 > text.size())
+                    return Fail("Truncated \\u escape");
+
+                char* end;
+                std::string digits = text.substr(at, 4);
+                unsigned code = strtoul(digits.c_str(), &end, 16);
+                if (end != digits.c_str() + 4)
+                    return Fail("Invalid \\u escape");
+
+                // Surrogate pairs are not combined, requests are expected to be ASCII
+                AppendUtf8(out, code);
+                at += 4;
+                break;
+            }
+            default:
+                return Fail("Invalid escape");
+            }
+        }
+
+        return Fail("Unterminated string");
+    }
+
+    bool ParseNumber(double& out) {
+        const char* start = text.c_str() + at;
+        char* end;
+        out = strtod(start, &end);
+
+        // strtod also accepts hex, inf and nan, none of which are JSON
+        if (end == start || !std::isfinite(out) || (*start != '-' && (*start < '0' || *start > '9')))
+            return Fail("Invalid number");
+
+        at += end - start;
+
+        return true;
+    }
+
+  public:
+    JsonParser(const std::string& text) : text(text) {}
+
+    bool ParseValue(JsonValue& value, int depth) {
+        if (depth > MAX_DEPTH)
+            return Fail("Nested too deeply");
+
+        SkipSpace();
+        if (at >= text.size())
+            return Fail("Unexpected end of input");
+
+        char c = text[at];
+
+        if (c == '{') {
+            value.type = JsonValue::Type::Object;
+            at++;
+
+            SkipSpace();
+            if (at < text.size() && text[at] == '}') {
+                at++;
+                return true;
+            }
+
+            while (true) {
+                SkipSpace();
+                if (at >= text.size() || text[at] != '"')
+                    return Fail("Expected a key");
+
+                std::string key;
+                if (!ParseString(key))
+                    return false;
+
+                SkipSpace();
+                if (at >= text.size() || text[at] != ':')
+                    return Fail("Expected ':'");
+                at++;
+
+                value.members.push_back({key, JsonValue()});
+                if (!ParseValue(value.members.back().second, depth + 1))
+                    return false;
+
+                SkipSpace();
+                if (at < text.size() && text[at] == ',') {
+                    at++;
+                } else if (at < text.size() && text[at] == '}') {
+                    at++;
+                    return true;
+                } else {
+                    return Fail("Expected ',' or '}'");
+                }
+            }
+        }
+
+        if (c == '[') {
+            value.type = JsonValue::Type::Array;
+            at++;
+
+            SkipSpace();
+            if (at < text.size() && text[at] == ']') {
+                at++;
+                return true;
+            }
+
+            while (true) {
+                value.items.push_back(JsonValue());
+                if (!ParseValue(value.items.back(), depth + 1))
+                    return false;
+
+                SkipSpace();
+                if (at < text.size() && text[at] == ',') {
+                    at++;
+                } else if (at < text.size() && text[at] == ']') {
+                    at++;
+                    return true;
+                } else {
+                    return Fail("Expected ',' or ']'");
+                }
+            }
+        }
+
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return ParseString(value.string);
+        }
+
+        if (c == 't' || c == 'f') {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = c == 't';
+            return Literal(value.boolean ? "true" : "false");
+        }
+
+        if (c == 'n') {
+            value.type = JsonValue::Type::Null;
+            return Literal("null");
+        }
+
+        value.type = JsonValue::Type::Number;
+        return ParseNumber(value.number);
+    }
+
+    bool Finish() {
+        SkipSpace();
+        if (at != text.size())
+            return Fail("Trailing characters");
+
+        return true;
+    }
+
+    const std::string& get_error() {
+        return error;
+    }
+};
+
+bool JsonValue::Parse(const std::string& text, JsonValue& value, std::string& error) {
+    value = JsonValue();
+
+    JsonParser parser(text);
+    if (parser.ParseValue(value, 0) && parser.Finish())
+        return true;
+
+    error = parser.get_error();
+
+    return false;
+}
+
+JsonValue::Type JsonValue::get_type() const {
+    return type;
+}
+
+bool JsonValue::is_null() const {
+    return type == Type::Null;
+}
+
+bool JsonValue::is_number() const {
+    return type == Type::Number;
+}
+
+bool JsonValue::is_string() const {
+    return type == Type::String;
+}
+
+bool JsonValue::is_array() const {
+    return type == Type::Array;
+}
+
+bool JsonValue::is_object() const {
+    return type == Type::Object;
+}
+
+bool JsonValue::as_bool(bool fallback) const {
+    return type == Type::Bool ? boolean : fallback;
+}
+
+double JsonValue::as_number(double fallback) const {
+    return type == Type::Number ? number : fallback;
+}
+
+const std::string& JsonValue::as_string() const {
+    return string;
+}
+
+const std::vector<JsonValue>& JsonValue::as_array() const {
+    return items;
+}
+
+const JsonValue* JsonValue::find(const char* key) const {
+    for (auto& member : members) {
+        if (member.first == key)
+            return &member.second;
+    }
+
+    return nullptr;
+}
+
+std::string JsonValue::Dump() const {
+    switch (type) {
+    case Type::Null:
+        return "null";
+    case Type::Bool:
+        return boolean ? "true" : "false";
+    case Type::Number: {
+        std::ostringstream out;
+        out.precision(17);
+        out << number;
+        return out.str();
+    }
+    case Type::String:
+        return JsonQuote(string);
+    case Type::Array: {
+        std::string out = "[";
+        for (size_t i = 0; i < items.size(); i++)
+            out += (i > 0 ? ", " : "") + items[i].Dump();
+        return out + "]";
+    }
+    case Type::Object: {
+        std::string out = "{";
+        for (size_t i = 0; i < members.size(); i++)
+            out += (i > 0 ? ", " : "") + JsonQuote(members[i].first) + ": " + members[i].second.Dump();
+        return out + "}";
+    }
+    }
+
+    return "null";
+}
+
+std::string JsonQuote(const std::string& text) {
+    std::string out = "\"";
+
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)c);
+                out += escape;
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    return out + "\"";
+}
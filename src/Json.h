@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief A parsed JSON document, just enough of one to read requests with
+class JsonValue {
+  public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+  private:
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;
+    /// @brief In document order, lookups are linear since requests only have a handful of keys
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    friend class JsonParser;
+
+  public:
+    /// @return false with error describing where the text stopped being JSON
+    static bool Parse(const std::string& text, JsonValue& value, std::string& error);
+
+    Type get_type() const;
+    bool is_null() const;
+    bool is_number() const;
+    bool is_string() const;
+    bool is_array() const;
+    bool is_object() const;
+
+    bool as_bool(bool fallback = false) const;
+    double as_number(double fallback = 0) const;
+    const std::string& as_string() const;
+    const std::vector<JsonValue>& as_array() const;
+
+    /// @return nullptr if this is not an object or has no such key
+    const JsonValue* find(const char* key) const;
+
+    /// @brief Serializes back to compact JSON
+    std::string Dump() const;
+};
+
+/// @brief Quotes and escapes text as a JSON string
+std::string JsonQuote(const std::string& text);
@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <unordered_set>
+
+#include "DeltaStepping.h"
+#include "MultiAgentPlanner.h"
+#include "Trace.h"
+
+namespace {
+// splitmix64 like WorldGenerator, so the same seed places the same agents with any standard library
+uint64_t mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+MultiAgentPlanner::MultiAgentPlanner(std::shared_ptr<const WorldSnapshot> snapshot, const std::vector<AgentTask>& tasks,
+                                     MultiAgentOptions options)
+    : snapshot(snapshot), tasks(tasks), options(options), pool(options.threads) {
+    this->options.window = std::max(1, options.window);
+    this->options.execute = std::max(1, std::min(options.execute, this->options.window));
+
+    cell_count = snapshot->get_size().first * snapshot->get_size().second;
+
+    for (auto& task : tasks) {
+        paths.push_back({task.start});
+        costs.push_back(0);
+        reached.push_back(task.start == task.goal);
+    }
+}
+
+uint64_t MultiAgentPlanner::reservation_key(Position pos, int step) {
+    return (uint64_t)step * cell_count + snapshot->get_position_hashable(pos);
+}
+
+int MultiAgentPlanner::reserved_by(Position pos, int step) {
+    auto found = reservations.find(reservation_key(pos, step));
+
+    return found != reservations.end() ? found->second : -1;
+}
+
+bool MultiAgentPlanner::can_move(int agent, Position from, Position to, int step) {
+    int holder = reserved_by(to, step + 1);
+    if (holder != -1 && holder != agent)
+        return false;
+
+    // Swapping places with another agent means passing through it halfway
+    int oncoming = reserved_by(to, step);
+
+    return oncoming == -1 || oncoming == agent || oncoming != reserved_by(from, step + 1);
+}
+
+void MultiAgentPlanner::BuildHeuristics() {
+    TRACE_SCOPE("MultiAgentPlanner::BuildHeuristics");
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Agents sharing a goal share its grid
+    std::map<Position, int> goal_index;
+    std::vector<Position> goals;
+    for (auto& task : tasks) {
+        auto found = goal_index.find(task.goal);
+        if (found == goal_index.end()) {
+            found = goal_index.insert({task.goal, (int)goals.size()}).first;
+            goals.push_back(task.goal);
+        }
+
+        agent_heuristic.push_back(found->second);
+    }
+
+    heuristics.resize(goals.size());
+
+    // One grid per goal is already plenty of parallelism, each engine runs on the worker that owns it
+    std::vector<std::unique_ptr<DeltaStepping>> engines(pool.thread_count());
+
+    pool.ParallelFor(goals.size(), 1, [&](size_t begin, size_t end, int worker) {
+        if (engines[worker] == nullptr)
+            engines[worker].reset(new DeltaStepping(snapshot, 0, 1));
+        DeltaStepping& engine = *engines[worker];
+
+        for (size_t i = begin; i < end; i++) {
+            Position goal = goals[i];
+            engine.Run(goal);
+
+            // Moving into a cell costs its weight, so a path costs the same both ways up to swapping which end's
+            // weight is counted: the cost from a cell to the goal is the cost from the goal to it, plus the goal's
+            // weight, minus its own
+            std::vector<float>& grid = heuristics[i];
+            grid.assign(cell_count, std::numeric_limits<float>::infinity());
+
+            float goal_weight = snapshot->is_passable(goal) ? snapshot->get_weight(goal) : 0;
+            for (int x = 0; x < snapshot->get_size().first; x++) {
+                for (int y = 0; y < snapshot->get_size().second; y++) {
+                    float cost = engine.get_cost({x, y});
+                    if (!std::isinf(cost))
+                        grid[snapshot->get_position_hashable({x, y})] =
+                            std::max(0.0f, cost + goal_weight - snapshot->get_weight({x, y}));
+                }
+            }
+
+            grid[snapshot->get_position_hashable(goal)] = 0;
+        }
+    });
+
+    planner_stats.heuristic_grids = goals.size();
+    planner_stats.heuristic_ms = elapsed_ms(start);
+}
+
+std::vector<Position> MultiAgentPlanner::PlanWindow(int agent, size_t& expansions) {
+    const std::vector<float>& heuristic = heuristics[agent_heuristic[agent]];
+    Position goal = tasks[agent].goal;
+
+    struct Node {
+        Position cell;
+        int step;
+        float cost;
+        int parent;
+    };
+    std::vector<Node> nodes = {{paths[agent].back(), 0, 0, -1}};
+    // Cheapest node reaching each (cell, step)
+    std::unordered_map<uint64_t, int> best = {{reservation_key(nodes[0].cell, 0), 0}};
+
+    // Ties go to the deeper state, which heads for the end of the window instead of widening the search
+    typedef std::tuple<float, int, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    open.push(Entry(heuristic[snapshot->get_position_hashable(nodes[0].cell)], 0, 0));
+
+    // Kept in case the agent is boxed in and never sees the end of the window
+    int deepest = 0;
+    float deepest_estimate = std::numeric_limits<float>::infinity();
+
+    while (!open.empty()) {
+        float estimate = std::get<0>(open.top());
+        int index = std::get<2>(open.top());
+        open.pop();
+
+        Node node = nodes[index];
+        if (best[reservation_key(node.cell, node.step)] != index)
+            continue;
+
+        expansions++;
+
+        if (node.step > nodes[deepest].step || (node.step == nodes[deepest].step && estimate < deepest_estimate)) {
+            deepest = index;
+            deepest_estimate = estimate;
+        }
+
+        if (node.step == options.window)
+            break;
+
+        Position moves[] = {node.cell,
+                            {node.cell.first + 1, node.cell.second},
+                            {node.cell.first - 1, node.cell.second},
+                            {node.cell.first, node.cell.second + 1},
+                            {node.cell.first, node.cell.second - 1}};
+
+        for (auto next : moves) {
+            if (!snapshot->in_bounds(next) || (next != node.cell && !snapshot->is_passable(next)))
+                continue;
+
+            float remaining = heuristic[snapshot->get_position_hashable(next)];
+            if (std::isinf(remaining) && next != node.cell)
+                continue;
+
+            if (!can_move(agent, node.cell, next, node.step))
+                continue;
+
+            float step_cost = next == goal && next == node.cell ? 0 : snapshot->get_weight(next);
+            float cost = node.cost + (snapshot->is_passable(next) ? step_cost : 0);
+
+            uint64_t key = reservation_key(next, node.step + 1);
+            auto found = best.find(key);
+            if (found != best.end() && nodes[found->second].cost <= cost)
+                continue;
+
+            best[key] = nodes.size();
+            nodes.push_back({next, node.step + 1, cost, index});
+            open.push(Entry(cost + remaining, -(node.step + 1), (int)nodes.size() - 1));
+        }
+    }
+
+    std::vector<Position> plan;
+    for (int index = deepest; index != -1; index = nodes[index].parent)
+        plan.push_back(nodes[index].cell);
+    std::reverse(plan.begin(), plan.end());
+
+    return plan;
+}
+
+std::vector<std::vector<Position>> MultiAgentPlanner::PlanRound(size_t round) {
+    TRACE_SCOPE("MultiAgentPlanner::PlanRound");
+
+    size_t agent_count = tasks.size();
+
+    // Agents that have been at their goal yield to everyone still travelling, so whoever has to get past one parked in
+    // a corridor can push it aside until they are through. Otherwise priority rotates every round
+    std::vector<int> order;
+    for (size_t i = 0; i < agent_count; i++)
+        order.push_back((i + round) % agent_count);
+
+    std::stable_partition(order.begin(), order.end(), [&](int agent) { return !reached[agent]; });
+
+    std::vector<std::vector<Position>> plans(agent_count);
+    std::vector<size_t> expansions(pool.thread_count(), 0);
+
+    // An agent boxed in by the plans above it could only promise its first step, and carrying out one step a round
+    // while the same plans box it in again never gets anywhere. It is pinned to its cell for the whole round instead,
+    // and everyone plans again around it
+    std::vector<bool> pinned(agent_count, false);
+
+    while (true) {
+        // Everyone keeps their cell for the first step, so waiting is always possible
+        reservations.clear();
+        for (size_t agent = 0; agent < agent_count; agent++) {
+            int hold = pinned[agent] ? options.window : 1;
+            for (int step = 0; step <= hold; step++)
+                reservations[reservation_key(paths[agent].back(), step)] = agent;
+        }
+
+        std::vector<int> pending;
+        for (int agent : order) {
+            if (pinned[agent])
+                plans[agent].assign(options.window + 1, paths[agent].back());
+            else
+                pending.push_back(agent);
+        }
+
+        while (!pending.empty()) {
+            planner_stats.waves++;
+
+            // The reservation table is only read while agents plan, and only written between waves
+            std::vector<std::vector<Position>> wave(pending.size());
+            pool.ParallelFor(pending.size(), 1, [&](size_t begin, size_t end, int worker) {
+                for (size_t i = begin; i < end; i++)
+                    wave[i] = PlanWindow(pending[i], expansions[worker]);
+            });
+
+            std::vector<int> rejected;
+            for (size_t i = 0; i < pending.size(); i++) {
+                int agent = pending[i];
+                const std::vector<Position>& plan = wave[i];
+
+                bool clear = true;
+                for (size_t step = 1; step < plan.size() && clear; step++)
+                    clear = can_move(agent, plan[step - 1], plan[step], step - 1);
+
+                if (!clear) {
+                    rejected.push_back(agent);
+                    continue;
+                }
+
+                for (size_t step = 0; step < plan.size(); step++)
+                    reservations[reservation_key(plan[step], step)] = agent;
+
+                plans[agent] = plan;
+            }
+
+            planner_stats.rejected += rejected.size();
+            pending = rejected;
+        }
+
+        bool boxed_in = false;
+        for (size_t agent = 0; agent < agent_count; agent++) {
+            if ((int)plans[agent].size() <= options.window) {
+                pinned[agent] = true;
+                boxed_in = true;
+                planner_stats.pinned++;
+            }
+        }
+
+        if (!boxed_in)
+            break;
+    }
+
+    for (size_t count : expansions)
+        planner_stats.expansions += count;
+    planner_stats.rounds++;
+
+    return plans;
+}
+
+void MultiAgentPlanner::Run() {
+    TRACE_SCOPE("MultiAgentPlanner::Run");
+
+    if (tasks.empty())
+        return;
+
+    if (heuristics.empty())
+        BuildHeuristics();
+
+    auto start = std::chrono::steady_clock::now();
+
+    int steps = paths[0].size() - 1;
+    for (size_t round = 0; !all_arrived() && steps < options.max_steps; round++) {
+        std::vector<std::vector<Position>> plans = PlanRound(round);
+
+        int carry_out = std::min(options.execute, options.max_steps - steps);
+
+        for (size_t agent = 0; agent < tasks.size(); agent++) {
+            for (int step = 1; step <= carry_out; step++) {
+                Position from = paths[agent].back();
+                Position to = plans[agent][step];
+
+                if (snapshot->is_passable(to) && !(to == from && to == tasks[agent].goal))
+                    costs[agent] += snapshot->get_weight(to);
+
+                paths[agent].push_back(to);
+                if (to == tasks[agent].goal)
+                    reached[agent] = true;
+            }
+        }
+
+        steps += carry_out;
+    }
+
+    // Drop the steps at the end of the last round where everyone was already waiting at their goal
+    size_t length = makespan() + 1;
+    for (auto& path : paths)
+        path.resize(std::min(path.size(), length));
+
+    planner_stats.planning_ms += elapsed_ms(start);
+}
+
+bool MultiAgentPlanner::all_arrived() {
+    return arrived_count() == tasks.size();
+}
+
+size_t MultiAgentPlanner::arrived_count() {
+    size_t arrived = 0;
+    for (size_t agent = 0; agent < tasks.size(); agent++) {
+        if (paths[agent].back() == tasks[agent].goal)
+            arrived++;
+    }
+
+    return arrived;
+}
+
+const std::vector<Position>& MultiAgentPlanner::get_path(int agent) {
+    return paths[agent];
+}
+
+float MultiAgentPlanner::get_cost(int agent) {
+    return costs[agent];
+}
+
+float MultiAgentPlanner::get_total_cost() {
+    float total = 0;
+    for (float cost : costs)
+        total += cost;
+
+    return total;
+}
+
+size_t MultiAgentPlanner::makespan() {
+    size_t last = 0;
+    for (size_t agent = 0; agent < tasks.size(); agent++) {
+        const std::vector<Position>& path = paths[agent];
+
+        // The step after which the agent never leaves its goal again
+        size_t settled = path.size() - 1;
+        while (settled > 0 && path[settled] == tasks[agent].goal && path[settled - 1] == tasks[agent].goal)
+            settled--;
+
+        last = std::max(last, settled);
+    }
+
+    return last;
+}
+
+MultiAgentStats MultiAgentPlanner::stats() {
+    return planner_stats;
+}
+
+size_t MultiAgentPlanner::CountConflicts() {
+    size_t conflicts = 0;
+    size_t length = 0;
+    for (auto& path : paths)
+        length = std::max(length, path.size());
+
+    auto at = [&](size_t agent, size_t step) { return paths[agent][std::min(step, paths[agent].size() - 1)]; };
+
+    for (size_t step = 0; step < length; step++) {
+        std::unordered_map<PositionHashable, size_t> occupied;
+
+        for (size_t agent = 0; agent < tasks.size(); agent++) {
+            auto inserted = occupied.insert({snapshot->get_position_hashable(at(agent, step)), agent});
+            if (!inserted.second) {
+                conflicts++;
+                continue;
+            }
+
+            if (step == 0)
+                continue;
+
+            // Whoever is now where this agent was, coming from where this agent is now
+            auto other = occupied.find(snapshot->get_position_hashable(at(agent, step - 1)));
+            if (other != occupied.end() && other->second != agent && at(agent, step) != at(agent, step - 1) &&
+                at(other->second, step - 1) == at(agent, step))
+                conflicts++;
+        }
+    }
+
+    return conflicts;
+}
+
+std::vector<AgentTask> MultiAgentPlanner::RandomTasks(const WorldSnapshot& world, int count, uint64_t seed) {
+    std::vector<Position> cells;
+    for (int x = 0; x < world.get_size().first; x++) {
+        for (int y = 0; y < world.get_size().second; y++) {
+            if (world.is_passable({x, y}))
+                cells.push_back({x, y});
+        }
+    }
+
+    uint64_t state = mix(seed);
+    auto below = [&](size_t bound) {
+        state += 0x9E3779B97F4A7C15ull;
+        return (size_t)(mix(state) % bound);
+    };
+
+    // Shuffled so starts are distinct
+    std::vector<Position> starts = cells;
+    for (size_t i = starts.size(); i > 1; i--)
+        std::swap(starts[i - 1], starts[below(i)]);
+
+    std::vector<AgentTask> tasks;
+    std::unordered_set<PositionHashable> used_goals;
+
+    for (size_t i = 0; i < starts.size() && (int)tasks.size() < count; i++) {
+        Position start = starts[i];
+
+        // Take the first unused goal in the start's component, a handful of tries is plenty unless the map is mostly
+        // tiny islands
+        for (size_t tries = 0; tries < 64; tries++) {
+            Position goal = cells[below(cells.size())];
+            if (goal == start || used_goals.count(world.get_position_hashable(goal)) > 0 ||
+                !world.is_reachable(start, goal))
+                continue;
+
+            used_goals.insert(world.get_position_hashable(goal));
+            tasks.push_back({start, goal});
+            break;
+        }
+    }
+
+    return tasks;
+}
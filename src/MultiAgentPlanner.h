@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "WorkerPool.h"
+#include "WorldSnapshot.h"
+
+/// @brief Where one agent starts and where it has to end up
+struct AgentTask {
+    Position start;
+    Position goal;
+};
+
+struct MultiAgentOptions {
+    /// @brief Steps each agent plans ahead around the others, beyond that it only follows its heuristic
+    int window = 16;
+    /// @brief Steps carried out before every agent plans again, at most window
+    int execute = 8;
+    /// @brief Gives up on agents still away from their goals after this many steps
+    int max_steps = 10000;
+    /// @brief Threads planning agents, 0 for one per hardware thread
+    int threads = 0;
+};
+
+/// @brief Counters describing how much work a MultiAgentPlanner has done
+struct MultiAgentStats {
+    /// @brief Times every agent planned its next window
+    size_t rounds = 0;
+    /// @brief Passes planning every agent still waiting for an accepted plan in parallel
+    size_t waves = 0;
+    /// @brief Plans thrown away for running into a plan accepted earlier in the same wave
+    size_t rejected = 0;
+    /// @brief Times an agent boxed in by the others was held in place for a round while everyone planned again
+    size_t pinned = 0;
+    /// @brief Space-time states expanded over every agent's searches
+    size_t expansions = 0;
+    /// @brief Distinct goals a cost grid was computed for
+    size_t heuristic_grids = 0;
+    double heuristic_ms = 0;
+    double planning_ms = 0;
+};
+
+/// @brief Moves many agents over one snapshot at once without any two ever sharing a cell or swapping places
+/// (windowed hierarchical cooperative A*, after Silver's WHCA*)
+///
+/// Time advances in steps, every step an agent either waits or moves to a neighbor. Moving costs the weight of the
+/// cell entered as for a single agent, waiting costs the weight of the cell waited on except at the agent's goal,
+/// where it is free. Each agent searches space-time A* for its next window steps around the cells and moves other
+/// agents have reserved in a shared table, guided by the exact cost to its goal ignoring the others. Those costs are
+/// single-agent cost grids from DeltaStepping, one per distinct goal.
+///
+/// Agents plan their window in parallel against the reservations made so far, then the plans are checked in priority
+/// order: a plan clashing with one accepted earlier in the wave is sent back to plan again with the new reservations,
+/// the rest are reserved. The first agent of each wave always gets through, so every round finishes. Agents that have
+/// reached their goal come last and step aside for the others, otherwise priority rotates between rounds so no agent is
+/// always last. Every agent holds its cell for the first step of each round, so even a boxed in agent can always wait.
+/// One that cannot plan its whole window is pinned to its cell for the round and everyone plans again around it, so
+/// every round carries out execute steps.
+class MultiAgentPlanner {
+  private:
+    std::shared_ptr<const WorldSnapshot> snapshot;
+    std::vector<AgentTask> tasks;
+    MultiAgentOptions options;
+    int cell_count;
+
+    WorkerPool pool;
+
+    /// @brief Exact cost from every cell to a goal ignoring other agents, infinity where it is unreachable
+    std::vector<std::vector<float>> heuristics;
+    /// @brief Index into heuristics of each agent's goal
+    std::vector<int> agent_heuristic;
+
+    /// @brief Agent holding each (cell, step) of the current round, keyed by step * cell_count + cell
+    std::unordered_map<uint64_t, int> reservations;
+
+    /// @brief Cell of every agent at every step carried out so far
+    std::vector<std::vector<Position>> paths;
+    std::vector<float> costs;
+    /// @brief Whether each agent has been at its goal, even if it since had to step aside
+    std::vector<bool> reached;
+
+    MultiAgentStats planner_stats;
+
+    uint64_t reservation_key(Position pos, int step);
+    /// @return Agent holding pos at step, -1 if nobody does
+    int reserved_by(Position pos, int step);
+    /// @brief Whether agent can go from one cell to another between step and step + 1
+    bool can_move(int agent, Position from, Position to, int step);
+
+    void BuildHeuristics();
+    /// @brief Space-time A* over the next window steps around the current reservations
+    /// @return The cells of the plan from step 0, fewer than window + 1 if the agent is boxed in
+    std::vector<Position> PlanWindow(int agent, size_t& expansions);
+    /// @return The cells of every agent's accepted plan for the round, window + 1 of them each
+    std::vector<std::vector<Position>> PlanRound(size_t round);
+
+  public:
+    MultiAgentPlanner(std::shared_ptr<const WorldSnapshot> snapshot, const std::vector<AgentTask>& tasks,
+                      MultiAgentOptions options = MultiAgentOptions());
+
+    /// @brief Plans and carries out round after round until every agent is at its goal or max_steps have passed
+    void Run();
+
+    bool all_arrived();
+    size_t arrived_count();
+    /// @return Cell of the agent at every step, starting with its start
+    const std::vector<Position>& get_path(int agent);
+    float get_cost(int agent);
+    float get_total_cost();
+    /// @brief Steps taken until the last agent arrived (or gave up)
+    size_t makespan();
+    MultiAgentStats stats();
+
+    /// @brief Counts pairs of agents sharing a cell or swapping places on the paths carried out, always 0 unless
+    /// something is broken
+    size_t CountConflicts();
+
+    /// @brief Picks count agents with distinct passable starts and distinct goals, each goal reachable from its start
+    static std::vector<AgentTask> RandomTasks(const WorldSnapshot& world, int count, uint64_t seed);
+};
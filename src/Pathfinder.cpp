@@ -1,66 +1,96 @@
 #include <algorithm>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <tuple>
-#include <unordered_set>
 
 #include "Pathfinder.h"
+#include "SearchTrace.h"
+#include "Trace.h"
 
-PathFinder::PathFinder(World* world, PathfinderHeuristicFn heuristic_fn) {
-    if (world == nullptr) {
+PathFinder::PathFinder(World* world, PathfinderHeuristicFn heuristic_fn, SearchContext* context,
+                       SearchOptions options)
+    : PathFinder(world != nullptr ? world->snapshot() : nullptr, heuristic_fn, context, options) {
+    this->world = world;
+}
+
+PathFinder::PathFinder(std::shared_ptr<const WorldSnapshot> snapshot, PathfinderHeuristicFn heuristic_fn,
+                       SearchContext* context, SearchOptions options) {
+    if (snapshot == nullptr) {
         std::cout << "PathFinder was given a nullptr world" << std::endl;
 
         return;
     }
 
-    if (world->locked) {
-        std::cout << "PathFinder was given a locked world" << std::endl;
+    this->snapshot = snapshot;
+    this->Heuristic = heuristic_fn;
 
-        return;
+    if (context == nullptr) {
+        owned_context.reset(new SearchContext());
+        context = owned_context.get();
     }
+    this->context = context;
 
-    this->world = world;
-    this->Heuristic = heuristic_fn;
-
-    world->locked = true;
+    this->options = options;
+    if (options.mode != SearchMode::Exact)
+        epsilon = std::max(1.0f, options.epsilon);
+    suboptimality_bound = std::numeric_limits<float>::infinity();
 
     Setup();
 }
 
-PathFinder::~PathFinder() {
-    world->locked = false;
-}
+PathFinder::~PathFinder() {}
 
 void PathFinder::Setup() {
-    current_position = world->get_spawn();
+    TRACE_SCOPE("PathFinder::Setup");
+
+    current_position = snapshot->get_spawn();
+    current_goal_path = 0;
+
+    if (recorder != nullptr)
+        recorder->RecordRestart();
+
+    goal_paths.clear();
+    progress.clear();
+    goal_progress.clear();
 
-    std::vector<Position> goal_path = world->get_goals();
+    const std::vector<Position>& goals = snapshot->get_goals();
+    std::vector<Position> goal_path = goals;
 
-    if (world->get_goals().size() == 0) {
-        goal_paths.push_back({current_position, world->get_destination()});
+    if (goals.size() == 0) {
+        goal_paths.push_back({current_position, snapshot->get_destination()});
     } else {
         std::vector<Position> goal_path_final = {current_position};
         goal_path_final.insert(goal_path_final.end(), goal_path.begin(), goal_path.end());
-        goal_path_final.push_back(world->get_destination());
+        goal_path_final.push_back(snapshot->get_destination());
         goal_paths.push_back(goal_path_final);
     }
 
-    if (world->get_goals().size() > 0) {
+    // Undirected connectivity does not depend on the order goals are visited in, if any goal or the destination is
+    // walled off from spawn every permutation is doomed, so skip enumerating them and leave the open set empty
+    bool reachable = snapshot->is_reachable(current_position, snapshot->get_destination());
+    for (auto goal : goal_path)
+        reachable = reachable && snapshot->is_reachable(current_position, goal);
+
+    if (reachable && goals.size() > 0) {
+        TRACE_SCOPE("PathFinder::Setup permutations");
+
         // Build Goal Paths Using QuickPerm (quickperm.org)
-        std::vector<unsigned int> p(world->get_goals().size() + 1);
+        std::vector<unsigned int> p(goals.size() + 1);
         unsigned int i, j;
-        for (i = 0; i < world->get_goals().size(); i++) {
+        for (i = 0; i < goals.size(); i++) {
             p[i] = i;
         }
-        p[world->get_goals().size()] = world->get_goals().size();
+        p[goals.size()] = goals.size();
         i = 1;
-        while (i < world->get_goals().size()) {
+        while (i < goals.size()) {
             p[i]--;
             j = i % 2 * p[i];
             std::swap(goal_path[j], goal_path[i]);
 
             std::vector<Position> goal_path_final = {current_position};
             goal_path_final.insert(goal_path_final.end(), goal_path.begin(), goal_path.end());
-            goal_path_final.push_back(world->get_destination());
+            goal_path_final.push_back(snapshot->get_destination());
             goal_paths.push_back(goal_path_final);
 
             i = 1;
@@ -71,25 +101,113 @@ void PathFinder::Setup() {
         }
     }
 
-    for (size_t i = 0; i < goal_paths.size(); i++) {
-        previous.push_back({});
-        lowest_cost.push_back({});
-        progress.push_back({});
-        goal_progress.push_back(0);
+    if (options.prune)
+        FindLiveDeadEnds();
+
+    context->Reset(snapshot->get_size().first * snapshot->get_size().second, goal_paths.size());
+    progress.resize(goal_paths.size());
+    goal_progress.resize(goal_paths.size(), 0);
 
-        lowest_cost[i][world->get_position_hashable(current_position)] = 0;
+    current_cost = 0;
+    current_heuristic = 0;
+
+    for (size_t i = 0; reachable && i < goal_paths.size(); i++) {
+        context->at(i, snapshot->get_position_hashable(current_position)).lowest_cost = 0;
 
         current_cost = 0;
-        current_heuristic = Heuristic(world, current_position, goal_paths[i], goal_progress[i]);
+        current_heuristic = EvaluateHeuristic(current_position, i);
+
+        context->open_push({epsilon * current_heuristic, i, current_position});
+        search_stats.pushes++;
+    }
+
+    search_stats.peak_open_set = std::max(search_stats.peak_open_set, context->open_size());
+}
+
+void PathFinder::FindLiveDeadEnds() {
+    live_dead_ends.clear();
+    corridor_stops.clear();
+
+    auto keep = [&](Position stop) {
+        if (!snapshot->in_bounds(stop))
+            return;
+
+        corridor_stops.insert(snapshot->get_position_hashable(stop));
+
+        // The only way out of a dead end is up its tree
+        Position cell = stop;
+        while (snapshot->is_passable(cell) && snapshot->is_dead_end(cell)) {
+            if (!live_dead_ends.insert(snapshot->get_position_hashable(cell)).second)
+                return;
+
+            Position parent = snapshot->get_dead_end_parent(cell);
+            if (parent == cell)
+                return;
+
+            cell = parent;
+        }
+
+        corridor_stops.insert(snapshot->get_position_hashable(cell));
+    };
 
-        open_set.push({current_heuristic, i, current_position});
+    Position spawn = snapshot->get_spawn();
+    keep(spawn);
+    keep(snapshot->get_destination());
+    for (auto goal : snapshot->get_goals())
+        keep(goal);
+
+    // An impassable spawn is left through its neighbors
+    if (snapshot->in_bounds(spawn) && !snapshot->is_passable(spawn)) {
+        Position neighbors[] = {{spawn.first + 1, spawn.second},
+                                {spawn.first - 1, spawn.second},
+                                {spawn.first, spawn.second + 1},
+                                {spawn.first, spawn.second - 1}};
+
+        for (auto neighbor : neighbors) {
+            if (snapshot->in_bounds(neighbor) && snapshot->is_passable(neighbor))
+                keep(neighbor);
+        }
     }
 }
 
+bool PathFinder::CorridorNext(Position cell, Position from, Position& next) {
+    Position neighbors[] = {{cell.first + 1, cell.second},
+                            {cell.first - 1, cell.second},
+                            {cell.first, cell.second + 1},
+                            {cell.first, cell.second - 1}};
+
+    int ways = 0;
+    bool entered = false;
+    for (auto neighbor : neighbors) {
+        if (!snapshot->is_core(neighbor))
+            continue;
+
+        if (++ways > 2)
+            return false;
+
+        if (neighbor == from)
+            entered = true;
+        else
+            next = neighbor;
+    }
+
+    return ways == 2 && entered;
+}
+
+float PathFinder::EvaluateHeuristic(Position position, int goal_path) {
+    search_stats.heuristic_calls++;
+
+    return Heuristic(snapshot.get(), position, goal_paths[goal_path], goal_progress[goal_path]);
+}
+
 World* PathFinder::get_world() {
     return world;
 }
 
+std::shared_ptr<const WorldSnapshot> PathFinder::get_snapshot() {
+    return snapshot;
+}
+
 std::pair<int, int> PathFinder::get_current_position() {
     return current_position;
 }
@@ -109,9 +227,10 @@ float PathFinder::get_current_heuristic() {
 std::deque<std::pair<int, int>> PathFinder::get_current_path() {
     std::deque<std::pair<int, int>> current_path = {current_position};
 
-    while (previous[current_goal_path].find(world->get_position_hashable(current_path.back())) !=
-           previous[current_goal_path].end()) {
-        current_path.push_back(previous[current_goal_path][world->get_position_hashable(current_path.back())]);
+    SearchCell* cell = context->find(current_goal_path, snapshot->get_position_hashable(current_position));
+    while (cell != nullptr && cell->previous != -1) {
+        current_path.push_back(snapshot->get_position(cell->previous));
+        cell = context->find(current_goal_path, cell->previous);
     }
 
     if (progress[current_goal_path].size() > 0)
@@ -126,7 +245,14 @@ std::vector<Position> PathFinder::get_current_goal_path() {
 }
 
 bool PathFinder::completed() {
-    if (current_position == world->get_destination() &&
+    if (options.mode == SearchMode::Anytime)
+        return anytime_finished;
+
+    return search_completed();
+}
+
+bool PathFinder::search_completed() {
+    if (current_position == snapshot->get_destination() &&
         goal_progress[current_goal_path] + 1 == goal_paths[current_goal_path].size())
         return true;
 
@@ -149,52 +275,167 @@ bool PathFinder::completed() {
 }
 
 bool PathFinder::failed() {
-    return open_set.empty();
+    if (options.mode == SearchMode::Anytime)
+        return !solved && context->open_empty();
+
+    return context->open_empty();
+}
+
+bool PathFinder::has_solution() {
+    return solved;
+}
+
+std::deque<Position> PathFinder::get_best_path() {
+    return best_path;
+}
+
+float PathFinder::get_best_cost() {
+    return best_cost;
+}
+
+float PathFinder::get_suboptimality_bound() {
+    return suboptimality_bound;
+}
+
+float PathFinder::get_epsilon() {
+    return epsilon;
+}
+
+void PathFinder::RecordSolution() {
+    if (!solved || current_cost < best_cost) {
+        best_path = get_current_path();
+        best_cost = current_cost;
+        solved = true;
+    }
+
+    if (options.mode != SearchMode::Anytime)
+        suboptimality_bound = epsilon;
+}
+
+void PathFinder::SetSolution(int goal_path, const std::vector<Position>& path, float cost) {
+    current_goal_path = goal_path;
+    current_position = snapshot->get_destination();
+    current_cost = cost;
+    current_heuristic = 0;
+
+    // get_current_path() walks back from the destination through progress, the context holds nothing for it
+    goal_progress[goal_path] = goal_paths[goal_path].size();
+    progress[goal_path].assign(path.rbegin(), path.rend());
+    search_stats.goal_transitions += goal_paths[goal_path].size() - 1;
+
+    RecordSolution();
+}
+
+void PathFinder::NextIteration() {
+    TRACE_SCOPE("PathFinder anytime iteration");
+
+    if (search_completed())
+        RecordSolution();
+
+    // Whether this search improved on the best solution or was pruned away entirely, nothing better than epsilon
+    // times the best cost was left
+    suboptimality_bound = epsilon;
+
+    if (epsilon <= 1.0f) {
+        anytime_finished = true;
+
+        return;
+    }
+
+    epsilon = std::max(1.0f, epsilon - std::max(options.epsilon_step, 0.01f));
+
+    Setup();
 }
 
 int PathFinder::checks(Position pos) {
-    return checked_count[world->get_position_hashable(pos)];
+    return context->checks(snapshot->get_position_hashable(pos));
+}
+
+PathFinderStats PathFinder::stats() {
+    PathFinderStats result = search_stats;
+
+    size_t bytes = context->used_bytes();
+    for (size_t i = 0; i < goal_paths.size(); i++)
+        bytes += (progress[i].capacity() + goal_paths[i].capacity()) * sizeof(Position);
+    result.search_bytes = bytes;
+
+    return result;
+}
+
+void PathFinder::set_recorder(SearchTraceRecorder* recorder) {
+    this->recorder = recorder;
+}
+
+std::string PathFinderStats::to_json() {
+    std::ostringstream json;
+    json << "{\"nodes_expanded\": " << nodes_expanded << ", \"pushes\": " << pushes
+         << ", \"stale_pops\": " << stale_pops << ", \"re_expansions\": " << re_expansions
+         << ", \"peak_open_set\": " << peak_open_set << ", \"goal_transitions\": " << goal_transitions
+         << ", \"heuristic_calls\": " << heuristic_calls << ", \"corridor_cells\": " << corridor_cells
+         << ", \"search_bytes\": " << search_bytes << "}";
+
+    return json.str();
 }
 
 void PathFinder::Step() {
     if (completed() || failed())
         return;
 
-    auto weight = std::get<0>(open_set.top());
-    auto goal_path = std::get<1>(open_set.top());
-    auto position = std::get<2>(open_set.top());
+    if (options.mode == SearchMode::Anytime && (search_completed() || context->open_empty())) {
+        NextIteration();
+
+        return;
+    }
+
+    TRACE_SCOPE("PathFinder::Step");
+
+    auto weight = std::get<0>(context->open_top());
+    auto goal_path = std::get<1>(context->open_top());
+    auto position = std::get<2>(context->open_top());
 
     current_position = position;
     current_goal_path = goal_path;
 
-    current_cost = lowest_cost[goal_path][world->get_position_hashable(current_position)];
-    current_heuristic = Heuristic(world, current_position, goal_paths[goal_path], goal_progress[goal_path]);
-    checked_count[world->get_position_hashable(current_position)]++;
+    PositionHashable current_hashable = snapshot->get_position_hashable(current_position);
+    SearchCell& current_cell = context->at(goal_path, current_hashable);
 
-    open_set.pop();
+    current_cost = current_cell.lowest_cost;
+    current_heuristic = EvaluateHeuristic(current_position, goal_path);
+    context->AddCheck(current_hashable);
 
-    if (current_position == goal_paths[goal_path][goal_progress[goal_path]]) {
-        auto current_path = get_current_path();
+    context->open_pop();
 
-        std::priority_queue<HeapTuple, std::vector<HeapTuple>, std::greater<HeapTuple>> new_open_set = {};
-        while (!open_set.empty()) {
-            if (std::get<1>(open_set.top()) != goal_path)
-                new_open_set.push(open_set.top());
+    search_stats.nodes_expanded++;
+    if (weight > current_cost + epsilon * current_heuristic)
+        search_stats.stale_pops++;
+    else if (current_cell.expanded)
+        search_stats.re_expansions++;
+    current_cell.expanded = true;
 
-            open_set.pop();
-        }
+    if (recorder != nullptr)
+        recorder->RecordExpansion(goal_path, current_position);
 
-        open_set = new_open_set;
+    if (current_position == goal_paths[goal_path][goal_progress[goal_path]]) {
+        TRACE_SCOPE("PathFinder goal transition");
+
+        auto current_path = get_current_path();
+
+        context->open_remove_goal_path(goal_path);
 
-        lowest_cost[goal_path].clear();
-        previous[goal_path].clear();
-        lowest_cost[goal_path][world->get_position_hashable(current_position)] = current_cost;
+        context->ClearGoalPath(goal_path);
+        SearchCell& goal_cell = context->at(goal_path, current_hashable);
+        goal_cell.lowest_cost = current_cost;
+        goal_cell.expanded = true;
 
-        progress[goal_path] = std::vector<Position>(current_path.begin(), current_path.end());
+        progress[goal_path].assign(current_path.begin(), current_path.end());
         goal_progress[goal_path]++;
+        search_stats.goal_transitions++;
+
+        if (recorder != nullptr)
+            recorder->RecordGoalTransition(goal_path, goal_progress[goal_path]);
     }
 
-    std::vector<Position> neighbors = {
+    Position neighbors[] = {
         {current_position.first + 1, current_position.second},
         {current_position.first - 1, current_position.second},
         {current_position.first, current_position.second + 1},
@@ -202,35 +443,81 @@ void PathFinder::Step() {
     };
 
     for (auto neighbor : neighbors) {
-        PositionHashable neighbor_hashable = world->get_position_hashable(neighbor);
+        PositionHashable neighbor_hashable = snapshot->get_position_hashable(neighbor);
 
-        if (neighbor.first < 0 || neighbor.first >= world->get_size().first || neighbor.second < 0 ||
-            neighbor.second >= world->get_size().second)
+        if (neighbor.first < 0 || neighbor.first >= snapshot->get_size().first || neighbor.second < 0 ||
+            neighbor.second >= snapshot->get_size().second)
             continue;
 
-        if (world->get_weight(neighbor) >= 1000)
+        if (!snapshot->is_passable(neighbor))
             continue;
 
-        float new_weight = current_cost + world->get_weight(neighbor);
-        float new_heuristic = Heuristic(world, neighbor, goal_paths[goal_path], goal_progress[goal_path]);
+        if (options.prune && snapshot->is_dead_end(neighbor) && live_dead_ends.count(neighbor_hashable) == 0)
+            continue;
+
+        float new_weight = current_cost + snapshot->get_weight(neighbor);
+        PositionHashable previous_hashable = current_hashable;
+
+        // A corridor only leads on to its far end, so walk straight there and queue that instead of every cell on
+        // the way. The cells passed still get a cost and predecessor, so paths through them rebuild as usual.
+        if (options.prune) {
+            Position from = current_position;
+            Position next;
+            bool improved = true;
+
+            while (corridor_stops.count(neighbor_hashable) == 0 && CorridorNext(neighbor, from, next)) {
+                SearchCell& corridor_cell = context->at(goal_path, neighbor_hashable);
+                if (new_weight >= corridor_cell.lowest_cost) {
+                    improved = false;
+                    break;
+                }
+
+                corridor_cell.lowest_cost = new_weight;
+                corridor_cell.previous = previous_hashable;
+                search_stats.corridor_cells++;
+
+                from = neighbor;
+                previous_hashable = neighbor_hashable;
+                neighbor = next;
+                neighbor_hashable = snapshot->get_position_hashable(neighbor);
+                new_weight += snapshot->get_weight(neighbor);
+            }
+
+            if (!improved)
+                continue;
+        }
+
+        float new_heuristic = EvaluateHeuristic(neighbor, goal_path);
+
+        // Can not lead to anything cheaper than the best solution, the heuristic never overestimates
+        if (solved && new_weight + new_heuristic >= best_cost)
+            continue;
 
         // This finds the optimal path WITH NO REPETITION, will need to work some more (or maybe add switch) the
         // find the optimal path with "loops" and a check to stop overflows
-        if (lowest_cost[goal_path].find(neighbor_hashable) == lowest_cost[goal_path].end() ||
-            new_weight < lowest_cost[goal_path][neighbor_hashable]) {
-            lowest_cost[goal_path][neighbor_hashable] = new_weight;
-            previous[goal_path][neighbor_hashable] = current_position;
+        SearchCell& neighbor_cell = context->at(goal_path, neighbor_hashable);
+        if (new_weight < neighbor_cell.lowest_cost) {
+            neighbor_cell.lowest_cost = new_weight;
+            neighbor_cell.previous = previous_hashable;
 
-            open_set.push({new_weight + new_heuristic, goal_path, neighbor});
+            context->open_push({new_weight + epsilon * new_heuristic, goal_path, neighbor});
+            search_stats.pushes++;
         }
     }
+
+    search_stats.peak_open_set = std::max(search_stats.peak_open_set, context->open_size());
+
+    if (options.mode != SearchMode::Anytime && search_completed())
+        RecordSolution();
 }
 
-float Dijkstra::Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress) {
+float Dijkstra::Heuristic(const WorldSnapshot* world, Position current_position,
+                          const std::vector<Position>& goal_path, int goal_progress) {
     return 0.0f;
 }
 
-float AStar::Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress) {
+float AStar::Heuristic(const WorldSnapshot* world, Position current_position,
+                       const std::vector<Position>& goal_path, int goal_progress) {
     if (goal_progress >= goal_path.size())
         return 0;
 
@@ -252,8 +539,8 @@ float AStar::Heuristic(World* world, Position current_position, std::vector<Posi
     return distance_needed;
 }
 
-float DijkstraCrow::Heuristic(World* world, Position current_position, std::vector<Position> goal_path,
-                              int goal_progress) {
+float DijkstraCrow::Heuristic(const WorldSnapshot* world, Position current_position,
+                              const std::vector<Position>& goal_path, int goal_progress) {
     if (goal_progress >= goal_path.size())
         return 0;
 
@@ -278,8 +565,8 @@ float DijkstraCrow::Heuristic(World* world, Position current_position, std::vect
     return distance_needed;
 }
 
-float DijkstraFolly::Heuristic(World* world, Position current_position, std::vector<Position> goal_path,
-                               int goal_progress) {
+float DijkstraFolly::Heuristic(const WorldSnapshot* world, Position current_position,
+                               const std::vector<Position>& goal_path, int goal_progress) {
     if (goal_progress >= goal_path.size())
         return 0;
 
@@ -294,3 +581,19 @@ float DijkstraFolly::Heuristic(World* world, Position current_position, std::vec
 
     return (float)distance(current_position, goal_path[goal_progress]);
 }
+
+bool find_heuristic(const std::string& name, PathfinderHeuristicFn& heuristic_fn) {
+    if (name == "astar" || name == "A*") {
+        heuristic_fn = AStar::Heuristic;
+    } else if (name == "dijkstra") {
+        heuristic_fn = Dijkstra::Heuristic;
+    } else if (name == "crow") {
+        heuristic_fn = DijkstraCrow::Heuristic;
+    } else if (name == "folly") {
+        heuristic_fn = DijkstraFolly::Heuristic;
+    } else {
+        return false;
+    }
+
+    return true;
+}
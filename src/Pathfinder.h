@@ -1,44 +1,132 @@
 #pragma once
 
+#include <deque>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <string>
+#include <unordered_set>
 #include <utility>
 
+#include "SearchContext.h"
 #include "World.h"
 
-typedef std::function<float(World* world, Position, std::vector<Position>, int)> PathfinderHeuristicFn;
+class SearchTraceRecorder;
+
+typedef std::function<float(const WorldSnapshot* world, Position, const std::vector<Position>&, int)>
+    PathfinderHeuristicFn;
+
+/// @brief Counters describing how much work a PathFinder has done so far
+struct PathFinderStats {
+    /// @brief Entries popped from the open set and expanded
+    size_t nodes_expanded = 0;
+    /// @brief Entries pushed onto the open set
+    size_t pushes = 0;
+    /// @brief Popped entries whose cost had already been improved by a later push
+    size_t stale_pops = 0;
+    /// @brief Expansions of a cell that was already expanded in the same goal leg
+    size_t re_expansions = 0;
+    size_t peak_open_set = 0;
+    size_t goal_transitions = 0;
+    size_t heuristic_calls = 0;
+    /// @brief Cells passed straight through inside corridors, given a cost without ever being queued
+    size_t corridor_cells = 0;
+    /// @brief Rough estimate of the memory held by the search state
+    size_t search_bytes = 0;
+
+    std::string to_json();
+};
+
+enum class SearchMode {
+    /// @brief Expands by cost + heuristic, optimal for admissible heuristics
+    Exact,
+    /// @brief Expands by cost + epsilon * heuristic, trading optimality for fewer expansions
+    Weighted,
+    /// @brief Repeats weighted searches with a shrinking epsilon, each one pruned by the best solution so far, until
+    /// an epsilon of 1 proves the best solution optimal
+    Anytime,
+};
+
+struct SearchOptions {
+    SearchMode mode = SearchMode::Exact;
+    /// @brief Heuristic inflation for Weighted, and for the first Anytime search
+    float epsilon = 2.0f;
+    /// @brief How much each Anytime search lowers epsilon
+    float epsilon_step = 0.5f;
+    /// @brief Skip dead ends that hold no spawn, goal or destination and pass straight through corridors (cells with
+    /// exactly two neighbors outside dead ends). Never changes the cost found.
+    ///
+    /// Corridors are walked cell by cell as the search reaches them rather than stored as weighted edges, so an edit
+    /// never has to find and rebuild the corridors it cuts or joins. Only the heap work is saved, not the walk.
+    bool prune = true;
+};
 
-/// @brief Only have one pathfinder per world, a check is performed with a warning.
+/// @brief Searches a snapshot of a world, so any number of pathfinders can run on one world (even while it is being
+/// edited) and never see an edit made after they were created.
 class PathFinder {
   protected:
-    World* world;
+    World* world = nullptr;
+    std::shared_ptr<const WorldSnapshot> snapshot;
 
     void Setup();
 
     PathfinderHeuristicFn Heuristic;
+    float EvaluateHeuristic(Position position, int goal_path);
 
     Position current_position;
     float current_cost;
     float current_heuristic;
     int current_goal_path = 0;
 
-    std::unordered_map<PositionHashable, int> checked_count;
+    /// @brief Open set and per-cell state, either borrowed or owned_context
+    SearchContext* context;
+    std::unique_ptr<SearchContext> owned_context;
 
-    typedef std::tuple<float, int, Position> HeapTuple;
-    std::priority_queue<HeapTuple, std::vector<HeapTuple>, std::greater<HeapTuple>> open_set;
-
-    std::vector<std::unordered_map<PositionHashable, Position>> previous;
-    std::vector<std::unordered_map<PositionHashable, float>> lowest_cost;
     std::vector<std::vector<Position>> progress;
     std::vector<int> goal_progress;
     std::vector<std::vector<Position>> goal_paths;
 
-  public:
-    PathFinder(World* world, PathfinderHeuristicFn heuristic_fn);
-    ~PathFinder();
+    /// @brief Dead end cells on the way from spawn, a goal or the destination out to the rest of the map, the only
+    /// ones a pruned search enters
+    std::unordered_set<PositionHashable> live_dead_ends;
+    /// @brief Cells a pruned search never passes through without stopping: spawn, goals, the destination and where
+    /// their dead ends join the rest of the map
+    std::unordered_set<PositionHashable> corridor_stops;
+    /// @brief Fills live_dead_ends and corridor_stops for the snapshot's spawn, goals and destination
+    void FindLiveDeadEnds();
+    /// @return Whether cell is in a corridor entered from from, next being the cell it leads on to
+    bool CorridorNext(Position cell, Position from, Position& next);
+
+    PathFinderStats search_stats;
+    SearchTraceRecorder* recorder = nullptr;
+
+    SearchOptions options;
+    float epsilon = 1.0f;
+    bool anytime_finished = false;
+
+    /// @brief Best complete path found so far, IN REVERSE ORDER
+    std::deque<Position> best_path;
+    float best_cost = 0;
+    bool solved = false;
+    float suboptimality_bound;
+
+    bool search_completed();
+    void RecordSolution();
+    /// @brief For searches that do not step cell by cell, finishes with path (spawn first) along goal_path
+    void SetSolution(int goal_path, const std::vector<Position>& path, float cost);
+    void NextIteration();
 
-    /// @brief READ ONLY
+  public:
+    /// @param context Reused search storage, reset on construction. If nullptr the PathFinder allocates its own.
+    PathFinder(World* world, PathfinderHeuristicFn heuristic_fn, SearchContext* context = nullptr,
+               SearchOptions options = SearchOptions());
+    PathFinder(std::shared_ptr<const WorldSnapshot> snapshot, PathfinderHeuristicFn heuristic_fn,
+               SearchContext* context = nullptr, SearchOptions options = SearchOptions());
+    virtual ~PathFinder();
+
+    /// @brief READ ONLY, nullptr if constructed from a snapshot
     World* get_world();
+    /// @brief The version of the world being searched
+    std::shared_ptr<const WorldSnapshot> get_snapshot();
 
     Position get_current_position();
     int get_goal_progress();
@@ -48,26 +136,47 @@ class PathFinder {
     std::deque<Position> get_current_path();
     std::vector<Position> get_current_goal_path();
 
+    /// @brief For Anytime, only once the best solution is proven optimal
     bool completed();
     bool failed();
 
+    bool has_solution();
+    /// @return The best complete path found so far, IN REVERSE ORDER
+    std::deque<Position> get_best_path();
+    float get_best_cost();
+    /// @brief The best solution costs at most this many times the optimum, infinity before a solution is found.
+    /// Assumes an admissible heuristic.
+    float get_suboptimality_bound();
+    float get_epsilon();
+
     int checks(Position pos);
+    PathFinderStats stats();
+    /// @brief Reports every expansion, goal transition and restart from now on to recorder, nullptr to stop
+    void set_recorder(SearchTraceRecorder* recorder);
 
-    void Step();
+    virtual void Step();
 };
 
 namespace Dijkstra {
-float Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress);
+float Heuristic(const WorldSnapshot* world, Position current_position, const std::vector<Position>& goal_path,
+                int goal_progress);
 }
 
 namespace AStar {
-float Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress);
+float Heuristic(const WorldSnapshot* world, Position current_position, const std::vector<Position>& goal_path,
+                int goal_progress);
 }
 
 namespace DijkstraCrow {
-float Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress);
+float Heuristic(const WorldSnapshot* world, Position current_position, const std::vector<Position>& goal_path,
+                int goal_progress);
 }
 
 namespace DijkstraFolly {
-float Heuristic(World* world, Position current_position, std::vector<Position> goal_path, int goal_progress);
+float Heuristic(const WorldSnapshot* world, Position current_position, const std::vector<Position>& goal_path,
+                int goal_progress);
 }
+
+/// @brief Looks a heuristic up by name: astar (or A*), dijkstra, crow or folly
+/// @return false if there is no heuristic by that name
+bool find_heuristic(const std::string& name, PathfinderHeuristicFn& heuristic_fn);
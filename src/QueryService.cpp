@@ -0,0 +1,722 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "DeltaSteppingPathFinder.h"
+#include "HierarchyPathFinder.h"
+#include "QueryService.h"
+#include "Trace.h"
+
+namespace {
+std::string ok_response(const std::string& id, const std::string& fields) {
+    return "{\"id\": " + id + ", \"ok\": true" + (fields.empty() ? "" : ", " + fields) + "}";
+}
+
+std::string error_response(const std::string& id, const std::string& message) {
+    return "{\"id\": " + id + ", \"ok\": false, \"error\": " + JsonQuote(message) + "}";
+}
+
+/// @brief Whole numbers that fit in an int, casting anything else is undefined
+bool read_int(const JsonValue& value, int& number) {
+    if (!value.is_number())
+        return false;
+
+    double whole = value.as_number();
+    if (whole != std::floor(whole) || whole < std::numeric_limits<int>::min() ||
+        whole > std::numeric_limits<int>::max())
+        return false;
+
+    number = (int)whole;
+
+    return true;
+}
+
+/// @brief Reads [x, y]
+bool read_position(const JsonValue* value, Position& pos) {
+    if (value == nullptr || !value->is_array() || value->as_array().size() != 2)
+        return false;
+
+    return read_int(value->as_array()[0], pos.first) && read_int(value->as_array()[1], pos.second);
+}
+
+/// @brief Every search backend assumes moves never lower the cost, and the edit is journaled for good
+bool valid_weight(const JsonValue* value) {
+    return value != nullptr && value->is_number() && value->as_number() >= 0 &&
+           value->as_number() <= std::numeric_limits<float>::max();
+}
+
+/// @brief The same file under any relative path or symlink gives the same path
+std::string canonical_path(const std::string& path) {
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    if (_fullpath(resolved, path.c_str(), _MAX_PATH) != nullptr)
+        return resolved;
+#else
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (resolved != nullptr) {
+        std::string result = resolved;
+        free(resolved);
+
+        return result;
+    }
+#endif
+
+    return path;
+}
+
+std::string position_json(Position pos) {
+    return "[" + std::to_string(pos.first) + ", " + std::to_string(pos.second) + "]";
+}
+
+/// @brief Finite floats only, JSON has no infinity
+std::string number_json(double number) {
+    if (!std::isfinite(number))
+        return "null";
+
+    std::ostringstream out;
+    out << number;
+
+    return out.str();
+}
+} // namespace
+
+QueryService::QueryService(int threads) : started(Clock::now()) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    thread_count = threads;
+    for (int i = 0; i < threads; i++)
+        workers.push_back(std::thread(&QueryService::Work, this));
+}
+
+QueryService::~QueryService() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_ready.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+
+    while (!worlds.empty())
+        Unload(worlds.begin()->first);
+}
+
+void QueryService::Work() {
+    // Warm per thread search storage, reused by every route this thread answers
+    SearchContext context;
+    std::unique_ptr<ContractionHierarchyQuery> query;
+    std::shared_ptr<const ContractionHierarchy> query_hierarchy;
+
+    while (true) {
+        Route route;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [&]() { return stopping || !queue.empty(); });
+
+            if (queue.empty())
+                return;
+
+            route = std::move(queue.front());
+            queue.pop_front();
+            active++;
+        }
+
+        std::string response = Solve(route, context, query, query_hierarchy);
+        Respond("route", response, route.received, route.batch, route.batch_index);
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        active--;
+        if (active == 0 && queue.empty())
+            queue_idle.notify_all();
+    }
+}
+
+std::string QueryService::Solve(Route& route, SearchContext& context,
+                                std::unique_ptr<ContractionHierarchyQuery>& query,
+                                std::shared_ptr<const ContractionHierarchy>& query_hierarchy) {
+    TRACE_SCOPE("QueryService::Solve");
+
+    auto start = Clock::now();
+
+    std::unique_ptr<PathFinder> pathfinder;
+    std::string backend = route.algorithm;
+
+    if (route.hierarchy != nullptr) {
+        // Query scratch space is sized to its hierarchy, only replace it when the hierarchy is rebuilt
+        if (query_hierarchy != route.hierarchy) {
+            query.reset(new ContractionHierarchyQuery(route.hierarchy.get()));
+            query_hierarchy = route.hierarchy;
+        }
+
+        pathfinder.reset(new HierarchyPathFinder(route.snapshot, route.hierarchy.get(), &context, query.get()));
+    } else if (route.algorithm == "delta") {
+        // Routes already run in parallel with each other, so each one gets a single thread
+        pathfinder.reset(new DeltaSteppingPathFinder(route.snapshot, &context, 0, 1));
+    } else {
+        if (route.algorithm == "ch")
+            backend = "astar";
+
+        pathfinder.reset(new PathFinder(route.snapshot, route.heuristic_fn, &context, route.options));
+    }
+
+    while (!pathfinder->completed() && !pathfinder->failed())
+        pathfinder->Step();
+
+    double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::ostringstream fields;
+    fields << "\"backend\": " << JsonQuote(backend) << ", \"version\": " << route.snapshot->get_version()
+           << ", \"completed\": " << (pathfinder->completed() ? "true" : "false")
+           << ", \"cost\": " << (pathfinder->has_solution() ? number_json(pathfinder->get_best_cost()) : "null")
+           << ", \"expanded\": " << pathfinder->stats().nodes_expanded << ", \"search_ms\": " << elapsed;
+
+    if (route.want_path && pathfinder->has_solution()) {
+        std::deque<Position> path = pathfinder->get_best_path();
+
+        fields << ", \"path\": [";
+        for (auto cell = path.rbegin(); cell != path.rend(); cell++)
+            fields << (cell != path.rbegin() ? ", " : "") << position_json(*cell);
+        fields << "]";
+    }
+
+    return ok_response(route.id, fields.str());
+}
+
+void QueryService::WriteLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    *out << line << std::endl;
+}
+
+void QueryService::RecordLatency(const std::string& op, Clock::time_point received) {
+    double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - received).count();
+
+    std::lock_guard<std::mutex> lock(latencies_mutex);
+    Latencies& entry = latencies[op];
+
+    if (entry.recent.size() < Latencies::WINDOW)
+        entry.recent.push_back(elapsed);
+    else
+        entry.recent[entry.count % Latencies::WINDOW] = elapsed;
+
+    entry.count++;
+}
+
+void QueryService::Respond(const std::string& op, const std::string& response, Clock::time_point received,
+                           const std::shared_ptr<Batch>& batch, size_t batch_index) {
+    RecordLatency(op, received);
+
+    if (batch == nullptr) {
+        WriteLine(response);
+
+        return;
+    }
+
+    batch->results[batch_index] = response;
+    ReleaseBatch(batch);
+}
+
+void QueryService::ReleaseBatch(const std::shared_ptr<Batch>& batch) {
+    // The last one out writes the batch, the counter also orders every other result's write before it
+    if (batch->remaining.fetch_sub(1) != 1)
+        return;
+
+    std::string results;
+    for (size_t i = 0; i < batch->results.size(); i++)
+        results += (i > 0 ? ", " : "") + batch->results[i];
+
+    RecordLatency("batch", batch->received);
+    WriteLine(ok_response(batch->id, "\"results\": [" + results + "]"));
+}
+
+std::string QueryService::Load(const std::string& name, const std::string& map, bool hierarchy) {
+    if (worlds.count(name) > 0)
+        return "A world named " + name + " is already loaded";
+
+    // World falls back to a tiny placeholder for a missing file, which would be mistaken for the map
+    if (!std::ifstream(map, std::ios::binary).is_open())
+        return "Cannot open " + map;
+
+    // Two Worlds on one file would append to the same journal and race each other's compactions and sidecars
+    std::string path = canonical_path(map);
+    for (auto& entry : worlds) {
+        if (canonical_path(entry.second->map) == path)
+            return map + " is already loaded as " + entry.first;
+    }
+
+    std::unique_ptr<LoadedWorld> loaded(new LoadedWorld());
+    loaded->name = name;
+    loaded->map = map;
+    loaded->world.reset(new World(map.c_str()));
+    loaded->latest = loaded->world->snapshot();
+
+    // Built up front rather than in the background so a load is warm once answered
+    if (hierarchy) {
+        loaded->want_hierarchy = true;
+        loaded->hierarchy.reset(ContractionHierarchy::LoadOrBuild(map.c_str(), *loaded->latest));
+        loaded->hierarchy_version = loaded->latest->get_version();
+    }
+
+    worlds[name] = std::move(loaded);
+
+    return "";
+}
+
+void QueryService::Unload(const std::string& name) {
+    auto found = worlds.find(name);
+    if (found == worlds.end())
+        return;
+
+    // Queued routes hold their own snapshot and hierarchy, only the rebuild thread still needs the world
+    if (found->second->rebuild.joinable())
+        found->second->rebuild.join();
+
+    found->second->world->WaitForCompaction();
+    worlds.erase(found);
+}
+
+void QueryService::Published(LoadedWorld& loaded) {
+    std::shared_ptr<const WorldSnapshot> snapshot = loaded.world->snapshot();
+
+    std::lock_guard<std::mutex> lock(hierarchy_mutex);
+    loaded.latest = snapshot;
+
+    if (!loaded.want_hierarchy || loaded.rebuilding)
+        return;
+
+    if (loaded.hierarchy != nullptr && loaded.hierarchy_version == snapshot->get_version())
+        return;
+
+    // A finished rebuild thread has already let go of the lock, joining it cannot wait on us
+    if (loaded.rebuild.joinable())
+        loaded.rebuild.join();
+
+    loaded.rebuilding = true;
+    loaded.rebuild = std::thread(&QueryService::Rebuild, this, &loaded);
+}
+
+void QueryService::Rebuild(LoadedWorld* loaded) {
+    TRACE_SCOPE("QueryService::Rebuild");
+
+    // Edits arriving during a build are picked up by the next one, so a burst of edits costs at most two builds
+    while (true) {
+        std::shared_ptr<const WorldSnapshot> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(hierarchy_mutex);
+            if (loaded->hierarchy != nullptr && loaded->hierarchy_version == loaded->latest->get_version()) {
+                loaded->rebuilding = false;
+
+                return;
+            }
+
+            snapshot = loaded->latest;
+        }
+
+        // Saved as the sidecar too, so a restart replaying the same journal loads it instead of building
+        std::shared_ptr<const ContractionHierarchy> hierarchy(
+            ContractionHierarchy::LoadOrBuild(loaded->map.c_str(), *snapshot));
+
+        std::lock_guard<std::mutex> lock(hierarchy_mutex);
+        loaded->hierarchy = hierarchy;
+        loaded->hierarchy_version = snapshot->get_version();
+    }
+}
+
+std::string QueryService::Status() {
+    std::ostringstream fields;
+
+    double uptime = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    fields << "\"uptime_ms\": " << uptime << ", \"threads\": " << thread_count;
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        fields << ", \"queued\": " << queue.size() << ", \"active\": " << active;
+    }
+
+    fields << ", \"worlds\": [";
+    for (auto entry = worlds.begin(); entry != worlds.end(); entry++) {
+        LoadedWorld& loaded = *entry->second;
+        std::shared_ptr<const WorldSnapshot> snapshot = loaded.world->snapshot();
+
+        std::string hierarchy = "none";
+        {
+            std::lock_guard<std::mutex> lock(hierarchy_mutex);
+            if (loaded.hierarchy != nullptr && loaded.hierarchy_version == snapshot->get_version())
+                hierarchy = "ready";
+            else if (loaded.rebuilding)
+                hierarchy = "building";
+            else if (loaded.want_hierarchy)
+                hierarchy = "stale";
+        }
+
+        fields << (entry != worlds.begin() ? ", " : "") << "{\"name\": " << JsonQuote(loaded.name)
+               << ", \"map\": " << JsonQuote(loaded.map) << ", \"size\": " << position_json(snapshot->get_size())
+               << ", \"version\": " << snapshot->get_version() << ", \"hierarchy\": \"" << hierarchy << "\"}";
+    }
+    fields << "]";
+
+    // Nearest rank percentiles over the recent window of each op
+    fields << ", \"latency_ms\": {";
+    {
+        std::lock_guard<std::mutex> lock(latencies_mutex);
+
+        for (auto entry = latencies.begin(); entry != latencies.end(); entry++) {
+            std::vector<double> sorted = entry->second.recent;
+            std::sort(sorted.begin(), sorted.end());
+
+            auto percentile = [&](double p) {
+                size_t rank = (size_t)std::ceil(p * sorted.size());
+                return sorted[std::max<size_t>(rank, 1) - 1];
+            };
+
+            fields << (entry != latencies.begin() ? ", " : "") << JsonQuote(entry->first)
+                   << ": {\"count\": " << entry->second.count << ", \"p50\": " << percentile(0.5)
+                   << ", \"p90\": " << percentile(0.9) << ", \"p99\": " << percentile(0.99)
+                   << ", \"max\": " << sorted.back() << "}";
+        }
+    }
+    fields << "}";
+
+    return fields.str();
+}
+
+bool QueryService::Dispatch(const JsonValue& request, Clock::time_point received, std::shared_ptr<Batch> batch,
+                            size_t batch_index) {
+    const JsonValue* id_value = request.find("id");
+    std::string id = id_value != nullptr ? id_value->Dump() : "null";
+
+    // Unknown ops are tallied together, so status only ever lists a fixed set
+    static const char* const OPS[] = {"load", "unload", "route", "set_weight", "set_terrain", "set_terrain_weight",
+                                      "set_spawn", "set_destination", "add_goal", "remove_goal", "compact", "batch",
+                                      "status", "shutdown"};
+    const JsonValue* op_value = request.find("op");
+    std::string op = "invalid";
+    for (const char* known : OPS) {
+        if (op_value != nullptr && op_value->as_string() == known)
+            op = known;
+    }
+
+    auto fail = [&](const std::string& message) {
+        Respond(op, error_response(id, message), received, batch, batch_index);
+
+        return true;
+    };
+
+    if (!request.is_object())
+        return fail("Expected a JSON object");
+    if (op == "invalid")
+        return fail("Unknown op, expected one of load, unload, route, set_weight, set_terrain, set_terrain_weight, "
+                    "set_spawn, set_destination, add_goal, remove_goal, compact, batch, status or shutdown");
+
+    if (op == "shutdown") {
+        Respond(op, ok_response(id, ""), received, batch, batch_index);
+
+        return false;
+    }
+
+    if (op == "status") {
+        Respond(op, ok_response(id, Status()), received, batch, batch_index);
+
+        return true;
+    }
+
+    if (op == "batch") {
+        const JsonValue* requests = request.find("requests");
+        if (batch != nullptr)
+            return fail("Batches cannot be nested");
+        if (requests == nullptr || !requests->is_array())
+            return fail("Expected \"requests\": [...]");
+
+        std::shared_ptr<Batch> pending = std::make_shared<Batch>();
+        pending->id = id;
+        pending->received = received;
+        pending->results.resize(requests->as_array().size());
+        // One extra so the batch cannot be written before every request in it has been dispatched
+        pending->remaining = pending->results.size() + 1;
+
+        bool keep_running = true;
+        for (size_t i = 0; i < requests->as_array().size(); i++)
+            keep_running = Dispatch(requests->as_array()[i], received, pending, i) && keep_running;
+
+        ReleaseBatch(pending);
+
+        return keep_running;
+    }
+
+    const JsonValue* name_value = request.find("world");
+    if (name_value == nullptr || !name_value->is_string())
+        return fail("Expected \"world\": <name>");
+    const std::string& name = name_value->as_string();
+
+    if (op == "load") {
+        const JsonValue* map = request.find("map");
+        if (map == nullptr || !map->is_string())
+            return fail("Expected \"map\": <file.dat>");
+
+        const JsonValue* hierarchy = request.find("hierarchy");
+        std::string error = Load(name, map->as_string(), hierarchy != nullptr && hierarchy->as_bool());
+        if (!error.empty())
+            return fail(error);
+
+        std::shared_ptr<const WorldSnapshot> snapshot = worlds[name]->latest;
+        Respond(op,
+                ok_response(id, "\"size\": " + position_json(snapshot->get_size()) +
+                                    ", \"goals\": " + std::to_string(snapshot->get_goals().size()) +
+                                    ", \"version\": " + std::to_string(snapshot->get_version())),
+                received, batch, batch_index);
+
+        return true;
+    }
+
+    auto found = worlds.find(name);
+    if (found == worlds.end())
+        return fail("No world named " + name + " is loaded");
+    LoadedWorld& loaded = *found->second;
+    World* world = loaded.world.get();
+
+    if (op == "unload") {
+        Unload(name);
+        Respond(op, ok_response(id, ""), received, batch, batch_index);
+
+        return true;
+    }
+
+    if (op == "route") {
+        Route route;
+        route.id = id;
+        route.received = received;
+        route.batch = batch;
+        route.batch_index = batch_index;
+
+        const JsonValue* algorithm = request.find("algorithm");
+        route.algorithm = algorithm != nullptr && algorithm->is_string() ? algorithm->as_string() : "astar";
+
+        if (route.algorithm == "ch") {
+            route.heuristic_fn = AStar::Heuristic;
+        } else if (route.algorithm != "delta" && !find_heuristic(route.algorithm, route.heuristic_fn)) {
+            return fail("Unknown algorithm " + route.algorithm +
+                        ", expected astar, dijkstra, crow, folly, ch or delta");
+        }
+
+        const JsonValue* mode = request.find("mode");
+        if (mode != nullptr) {
+            if (mode->as_string() == "exact") {
+                route.options.mode = SearchMode::Exact;
+            } else if (mode->as_string() == "weighted") {
+                route.options.mode = SearchMode::Weighted;
+            } else if (mode->as_string() == "anytime") {
+                route.options.mode = SearchMode::Anytime;
+            } else {
+                return fail("Unknown mode, expected exact, weighted or anytime");
+            }
+        }
+
+        const JsonValue* epsilon = request.find("epsilon");
+        if (epsilon != nullptr)
+            route.options.epsilon = epsilon->as_number(route.options.epsilon);
+
+        const JsonValue* prune = request.find("prune");
+        if (prune != nullptr)
+            route.options.prune = prune->as_bool(true);
+
+        const JsonValue* path = request.find("path");
+        if (path != nullptr)
+            route.want_path = path->as_bool(true);
+
+        std::shared_ptr<const WorldSnapshot> snapshot = world->snapshot();
+
+        const JsonValue* from = request.find("from");
+        const JsonValue* to = request.find("to");
+        const JsonValue* goals = request.find("goals");
+        if (from != nullptr || to != nullptr || goals != nullptr) {
+            Position spawn = snapshot->get_spawn();
+            Position destination = snapshot->get_destination();
+            std::vector<Position> stops = snapshot->get_goals();
+
+            if (from != nullptr && (!read_position(from, spawn) || !snapshot->in_bounds(spawn)))
+                return fail("\"from\" must be an [x, y] inside the world");
+            if (to != nullptr && (!read_position(to, destination) || !snapshot->in_bounds(destination)))
+                return fail("\"to\" must be an [x, y] inside the world");
+
+            if (goals != nullptr) {
+                if (!goals->is_array())
+                    return fail("\"goals\" must be a list of [x, y]");
+
+                stops.clear();
+                for (auto& goal : goals->as_array()) {
+                    Position pos;
+                    if (!read_position(&goal, pos) || !snapshot->in_bounds(pos))
+                        return fail("\"goals\" must be a list of [x, y] inside the world");
+
+                    stops.push_back(pos);
+                }
+            }
+
+            snapshot = snapshot->WithStops(spawn, destination, stops);
+        }
+
+        route.snapshot = snapshot;
+
+        if (route.algorithm == "ch") {
+            std::lock_guard<std::mutex> lock(hierarchy_mutex);
+
+            if (loaded.hierarchy != nullptr && loaded.hierarchy_version == snapshot->get_version())
+                route.hierarchy = loaded.hierarchy;
+
+            // The first ch route on a world starts its hierarchy, answered with A* until it is ready
+            loaded.want_hierarchy = true;
+        }
+
+        if (route.algorithm == "ch" && route.hierarchy == nullptr)
+            Published(loaded);
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back(std::move(route));
+        }
+        queue_ready.notify_one();
+
+        return true;
+    }
+
+    if (op == "compact") {
+        world->Compact();
+        Respond(op, ok_response(id, ""), received, batch, batch_index);
+
+        return true;
+    }
+
+    // Everything else edits the world
+    Position at;
+    bool has_at = read_position(request.find("at"), at);
+    if (has_at && !world->in_bounds(at))
+        return fail("\"at\" is outside the world");
+
+    const JsonValue* weight = request.find("weight");
+    const JsonValue* terrain = request.find("terrain");
+
+    if (op == "set_weight") {
+        if (!has_at || !valid_weight(weight))
+            return fail("Expected \"at\": [x, y] and \"weight\": <weight at least 0>");
+
+        if (!world->set_weight(at, weight->as_number()))
+            return fail("The terrain palette is full, use a weight it already has");
+    } else if (op == "set_terrain") {
+        if (!has_at || terrain == nullptr || !terrain->is_number() || terrain->as_number() < 0 ||
+            terrain->as_number() >= world->get_palette().size())
+            return fail("Expected \"at\": [x, y] and \"terrain\": <class in the palette>");
+
+        world->set_terrain(at, (TerrainClass)terrain->as_number());
+    } else if (op == "set_terrain_weight") {
+        const JsonValue* passable = request.find("passable");
+        if (terrain == nullptr || !terrain->is_number() || terrain->as_number() < 0 ||
+            terrain->as_number() >= world->get_palette().size() || !valid_weight(weight))
+            return fail("Expected \"terrain\": <class in the palette> and \"weight\": <weight at least 0>");
+
+        TerrainClass terrain_class = (TerrainClass)terrain->as_number();
+        bool is_passable = passable != nullptr ? passable->as_bool(true) : world->get_palette()[terrain_class].passable;
+        world->set_terrain_weight(terrain_class, weight->as_number(), is_passable);
+    } else {
+        // set_spawn, set_destination, add_goal or remove_goal
+        if (!has_at)
+            return fail("Expected \"at\": [x, y]");
+
+        if (op == "set_spawn")
+            world->set_spawn(at);
+        else if (op == "set_destination")
+            world->set_destination(at);
+        else if (op == "add_goal")
+            world->add_goal(at);
+        else
+            world->remove_goal(at);
+    }
+
+    Published(loaded);
+    Respond(op, ok_response(id, "\"version\": " + std::to_string(world->snapshot()->get_version())), received, batch,
+            batch_index);
+
+    return true;
+}
+
+void QueryService::Run(std::istream& in, std::ostream& out) {
+    this->out = &out;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        Clock::time_point received = Clock::now();
+
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        JsonValue request;
+        std::string error;
+        if (!JsonValue::Parse(line, request, error)) {
+            Respond("invalid", error_response("null", error), received, nullptr, 0);
+            continue;
+        }
+
+        if (!Dispatch(request, received, nullptr, 0))
+            break;
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    queue_idle.wait(lock, [&]() { return queue.empty() && active == 0; });
+}
+
+bool QueryService::Preload(const std::string& name, const std::string& map, bool hierarchy) {
+    std::string error = Load(name, map, hierarchy);
+    if (!error.empty()) {
+        std::cerr << error << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+int RunService(int argc, char** argv) {
+    int threads = 0;
+    bool hierarchy = false;
+    std::vector<std::pair<std::string, std::string>> preload;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--serve") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hierarchy") == 0) {
+            hierarchy = true;
+        } else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc) {
+            std::string entry = argv[++i];
+            size_t equals = entry.find('=');
+            if (equals == std::string::npos) {
+                std::cerr << "Expected --world <name>=<file.dat>" << std::endl;
+
+                return 1;
+            }
+
+            preload.push_back({entry.substr(0, equals), entry.substr(equals + 1)});
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+
+            return 1;
+        }
+    }
+
+    QueryService service(threads);
+
+    for (auto& world : preload) {
+        if (!service.Preload(world.first, world.second, hierarchy))
+            return 1;
+    }
+
+    service.Run(std::cin, std::cout);
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ContractionHierarchy.h"
+#include "Json.h"
+#include "Pathfinder.h"
+#include "World.h"
+
+/// @brief Keeps named worlds loaded between requests and answers them as JSON lines, one request object per input
+/// line and one response object per output line
+///
+/// Every request may carry an "id", echoed back on its response. Responses to route requests can arrive out of order,
+/// everything else is answered before the next line is read. Requests are:
+///
+///   {"op": "load", "world": <name>, "map": <file.dat>, "hierarchy": <bool>}
+///   {"op": "unload", "world": <name>}
+///   {"op": "route", "world": <name>, "algorithm": astar|dijkstra|crow|folly|ch|delta, "mode": exact|weighted|anytime,
+///    "epsilon": <e>, "prune": <bool>, "from": [x, y], "to": [x, y], "goals": [[x, y], ...], "path": <bool>}
+///   {"op": "set_weight", "world": <name>, "at": [x, y], "weight": <weight>}
+///   {"op": "set_terrain", "world": <name>, "at": [x, y], "terrain": <class>}
+///   {"op": "set_terrain_weight", "world": <name>, "terrain": <class>, "weight": <weight>, "passable": <bool>}
+///   {"op": "set_spawn" | "set_destination" | "add_goal" | "remove_goal", "world": <name>, "at": [x, y]}
+///   {"op": "compact", "world": <name>}
+///   {"op": "batch", "requests": [<request>, ...]}
+///   {"op": "status"}
+///   {"op": "shutdown"}
+///
+/// Routes default to the world's own spawn, goals and destination, "from", "to" and "goals" replace them. Each one
+/// searches the version of the world current when its line was read, so it sees every edit sent before it and none
+/// sent after. A batch runs its routes in parallel and answers with one "results" array in request order.
+///
+/// Edits go through World as usual, so they are journaled next to the map. Weights must be finite and at least 0,
+/// anything else is rejected before it reaches the world. A world loaded with a hierarchy answers "ch" routes from it,
+/// and rebuilds it in the background after edits. Until the rebuild lands those routes are answered with A* and report
+/// "backend": "astar".
+class QueryService {
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct LoadedWorld {
+        std::string name;
+        std::string map;
+        /// @brief Only touched by the thread reading requests
+        std::unique_ptr<World> world;
+
+        // Guarded by hierarchy_mutex, shared with the rebuild thread
+        bool want_hierarchy = false;
+        /// @brief nullptr until the first build lands
+        std::shared_ptr<const ContractionHierarchy> hierarchy;
+        unsigned long hierarchy_version = 0;
+        /// @brief Latest version, what the rebuild thread builds from
+        std::shared_ptr<const WorldSnapshot> latest;
+        bool rebuilding = false;
+        std::thread rebuild;
+    };
+    std::map<std::string, std::unique_ptr<LoadedWorld>> worlds;
+    std::mutex hierarchy_mutex;
+
+    /// @brief Results of a batch, written back in one line once the last of them is done
+    struct Batch {
+        std::string id;
+        Clock::time_point received;
+        std::vector<std::string> results;
+        std::atomic<size_t> remaining;
+    };
+
+    struct Route {
+        std::string id;
+        Clock::time_point received;
+        std::shared_ptr<Batch> batch;
+        size_t batch_index = 0;
+
+        std::string algorithm;
+        PathfinderHeuristicFn heuristic_fn;
+        SearchOptions options;
+        bool want_path = true;
+
+        std::shared_ptr<const WorldSnapshot> snapshot;
+        /// @brief nullptr unless the algorithm is ch and the hierarchy matches snapshot
+        std::shared_ptr<const ContractionHierarchy> hierarchy;
+    };
+
+    // Routes waiting for a worker
+    std::deque<Route> queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    /// @brief Signalled whenever a worker finishes and nothing is left queued
+    std::condition_variable queue_idle;
+    bool stopping = false;
+    /// @brief Routes being solved right now
+    int active = 0;
+    std::vector<std::thread> workers;
+
+    std::ostream* out = nullptr;
+    std::mutex out_mutex;
+
+    /// @brief Recent latencies per request op, in milliseconds from reading the line to writing the response
+    struct Latencies {
+        static const size_t WINDOW = 4096;
+
+        size_t count = 0;
+        /// @brief Ring buffer over the last WINDOW requests
+        std::vector<double> recent;
+    };
+    std::map<std::string, Latencies> latencies;
+    std::mutex latencies_mutex;
+
+    Clock::time_point started;
+    int thread_count;
+
+    void Work();
+    std::string Solve(Route& route, SearchContext& context, std::unique_ptr<ContractionHierarchyQuery>& query,
+                      std::shared_ptr<const ContractionHierarchy>& query_hierarchy);
+
+    /// @brief Answers a request, either right away or by queuing a route
+    /// @return false if it asked the service to shut down
+    bool Dispatch(const JsonValue& request, Clock::time_point received, std::shared_ptr<Batch> batch,
+                  size_t batch_index);
+    /// @brief Writes a response, or stores it in its batch and writes the batch if it was the last one
+    void Respond(const std::string& op, const std::string& response, Clock::time_point received,
+                 const std::shared_ptr<Batch>& batch, size_t batch_index);
+    /// @brief Counts one result of a batch as done, writing the batch if it was the last
+    void ReleaseBatch(const std::shared_ptr<Batch>& batch);
+    void WriteLine(const std::string& line);
+    void RecordLatency(const std::string& op, Clock::time_point received);
+
+    /// @brief Loads map under name, each map file can only be loaded under one name at a time
+    /// @return An error message, empty on success
+    std::string Load(const std::string& name, const std::string& map, bool hierarchy);
+    void Unload(const std::string& name);
+    /// @brief Hands the latest version to the rebuild thread, starting it if it is not running
+    void Published(LoadedWorld& loaded);
+    void Rebuild(LoadedWorld* loaded);
+
+    std::string Status();
+
+  public:
+    /// @param threads Threads answering routes, 0 for one per hardware thread
+    QueryService(int threads = 0);
+    /// @brief Finishes queued routes and background rebuilds
+    ~QueryService();
+
+    /// @brief Answers requests from in until it ends or a shutdown request, returns once every response is written
+    void Run(std::istream& in, std::ostream& out);
+
+    /// @brief Loads a world before serving, as if a load request had been sent
+    /// @return false if the map could not be loaded, with the reason on std::cerr
+    bool Preload(const std::string& name, const std::string& map, bool hierarchy);
+};
+
+/// @brief Runs a QueryService on stdin and stdout
+///
+/// Usage: the_legend_of_alberta --serve [--threads <n>] [--world <name>=<file.dat>] [--hierarchy]
+///
+/// Each --world is loaded before the first request, with a contraction hierarchy if --hierarchy is given
+int RunService(int argc, char** argv);
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "SearchContext.h"
+
+void SearchContext::Reset(size_t cell_count, size_t goal_path_count) {
+    for (size_t i = 0; i < this->goal_path_count; i++)
+        ClearGoalPath(i);
+    check_counts.Clear(check_pages, check_directories);
+
+    this->goal_path_count = goal_path_count;
+
+    if (goal_path_cells.size() < goal_path_count)
+        goal_path_cells.resize(goal_path_count);
+    for (size_t i = 0; i < goal_path_count; i++)
+        goal_path_cells[i].Resize(cell_count);
+    check_counts.Resize(cell_count);
+
+    open_set.clear();
+}
+
+SearchCell* SearchContext::find(int goal_path, PositionHashable cell) {
+    SearchCell* search_cell = goal_path_cells[goal_path].find(cell);
+
+    if (search_cell == nullptr || search_cell->lowest_cost == std::numeric_limits<float>::infinity())
+        return nullptr;
+
+    return search_cell;
+}
+
+SearchCell& SearchContext::at(int goal_path, PositionHashable cell) {
+    return goal_path_cells[goal_path].at(cell, cell_pages, cell_directories,
+                                         SearchCell{std::numeric_limits<float>::infinity(), -1, false});
+}
+
+void SearchContext::ClearGoalPath(int goal_path) {
+    goal_path_cells[goal_path].Clear(cell_pages, cell_directories);
+}
+
+bool SearchContext::open_empty() {
+    return open_set.empty();
+}
+
+size_t SearchContext::open_size() {
+    return open_set.size();
+}
+
+const SearchContext::HeapTuple& SearchContext::open_top() {
+    return open_set.front();
+}
+
+void SearchContext::open_push(const HeapTuple& entry) {
+    open_set.push_back(entry);
+    std::push_heap(open_set.begin(), open_set.end(), std::greater<HeapTuple>());
+}
+
+void SearchContext::open_pop() {
+    std::pop_heap(open_set.begin(), open_set.end(), std::greater<HeapTuple>());
+    open_set.pop_back();
+}
+
+void SearchContext::open_remove_goal_path(int goal_path) {
+    open_set.erase(std::remove_if(open_set.begin(), open_set.end(),
+                                  [goal_path](const HeapTuple& entry) { return std::get<1>(entry) == goal_path; }),
+                   open_set.end());
+    std::make_heap(open_set.begin(), open_set.end(), std::greater<HeapTuple>());
+}
+
+int SearchContext::checks(PositionHashable cell) {
+    int* count = check_counts.find(cell);
+
+    return count != nullptr ? *count : 0;
+}
+
+void SearchContext::AddCheck(PositionHashable cell) {
+    check_counts.at(cell, check_pages, check_directories, 0)++;
+}
+
+size_t SearchContext::used_bytes() {
+    size_t bytes = cell_pages.used_bytes() + cell_directories.used_bytes() + check_pages.used_bytes() +
+                   check_directories.used_bytes() + check_counts.used_bytes() + open_set.size() * sizeof(HeapTuple);
+    for (size_t i = 0; i < goal_path_count; i++)
+        bytes += goal_path_cells[i].used_bytes();
+
+    return bytes;
+}
+
+size_t SearchContext::reserved_bytes() {
+    size_t bytes = cell_pages.reserved_bytes() + cell_directories.reserved_bytes() + check_pages.reserved_bytes() +
+                   check_directories.reserved_bytes() + check_counts.reserved_bytes() +
+                   open_set.capacity() * sizeof(HeapTuple);
+    for (auto& table : goal_path_cells)
+        bytes += table.reserved_bytes();
+
+    return bytes;
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "World.h"
+
+/// @brief Search state of one cell for one goal path
+struct SearchCell {
+    /// @brief Infinity until the cell has been reached
+    float lowest_cost;
+    /// @brief -1 if the cell has no predecessor in the current goal leg
+    PositionHashable previous;
+    bool expanded;
+};
+
+/// @brief Fixed size pages of T carved out of blocks that are never freed, released pages are handed out again
+template <typename T> class PagePool {
+  private:
+    size_t page_size;
+    size_t pages_per_block;
+
+    std::vector<std::unique_ptr<T[]>> blocks;
+    std::vector<T*> free_pages;
+
+  public:
+    PagePool(size_t page_size, size_t pages_per_block) : page_size(page_size), pages_per_block(pages_per_block) {}
+
+    /// @brief A page with every element set to fill
+    T* Allocate(const T& fill) {
+        if (free_pages.empty()) {
+            blocks.emplace_back(new T[pages_per_block * page_size]);
+            for (size_t i = 0; i < pages_per_block; i++)
+                free_pages.push_back(blocks.back().get() + i * page_size);
+        }
+
+        T* page = free_pages.back();
+        free_pages.pop_back();
+
+        std::fill(page, page + page_size, fill);
+
+        return page;
+    }
+
+    void Release(T* page) {
+        free_pages.push_back(page);
+    }
+
+    size_t used_bytes() {
+        return (blocks.size() * pages_per_block - free_pages.size()) * page_size * sizeof(T);
+    }
+
+    size_t reserved_bytes() {
+        return blocks.size() * pages_per_block * page_size * sizeof(T) + free_pages.capacity() * sizeof(T*);
+    }
+};
+
+/// @brief Finds the page holding a cell through a directory per DIRECTORY_PAGES pages, both taken from pools on first
+/// touch, so the table only grows with the parts of the world that were touched and clearing it only visits those
+template <typename T> class PageTable {
+  public:
+    static const int PAGE_BITS = 8;
+    static const size_t PAGE_CELLS = 1 << PAGE_BITS;
+    static const int DIRECTORY_BITS = 8;
+    static const size_t DIRECTORY_PAGES = 1 << DIRECTORY_BITS;
+
+  private:
+    /// @brief nullptr where nothing in the directory's cells was touched
+    std::vector<T**> directories;
+    /// @brief Every page in use, as directory * DIRECTORY_PAGES + page
+    std::vector<size_t> pages;
+
+  public:
+    /// @brief Prepares for a world of cell_count cells, only valid while the table is empty
+    void Resize(size_t cell_count) {
+        directories.resize((cell_count + PAGE_CELLS * DIRECTORY_PAGES - 1) / (PAGE_CELLS * DIRECTORY_PAGES), nullptr);
+    }
+
+    /// @return nullptr if the page holding cell has never been touched
+    T* find(size_t cell) {
+        T** directory = directories[cell >> (PAGE_BITS + DIRECTORY_BITS)];
+        if (directory == nullptr)
+            return nullptr;
+
+        T* page = directory[(cell >> PAGE_BITS) & (DIRECTORY_PAGES - 1)];
+        if (page == nullptr)
+            return nullptr;
+
+        return page + (cell & (PAGE_CELLS - 1));
+    }
+
+    /// @brief Takes the page holding cell (and its directory) from the pools if it is not there yet
+    T& at(size_t cell, PagePool<T>& page_pool, PagePool<T*>& directory_pool, const T& fill) {
+        T**& directory = directories[cell >> (PAGE_BITS + DIRECTORY_BITS)];
+        if (directory == nullptr)
+            directory = directory_pool.Allocate(nullptr);
+
+        T*& page = directory[(cell >> PAGE_BITS) & (DIRECTORY_PAGES - 1)];
+        if (page == nullptr) {
+            page = page_pool.Allocate(fill);
+            pages.push_back(cell >> PAGE_BITS);
+        }
+
+        return page[cell & (PAGE_CELLS - 1)];
+    }
+
+    /// @brief Hands every page and directory in use back to the pools
+    void Clear(PagePool<T>& page_pool, PagePool<T*>& directory_pool) {
+        for (size_t page : pages) {
+            T** directory = directories[page >> DIRECTORY_BITS];
+            page_pool.Release(directory[page & (DIRECTORY_PAGES - 1)]);
+            directory[page & (DIRECTORY_PAGES - 1)] = nullptr;
+        }
+
+        // Every page of a directory in use is listed, so the directories are all empty now
+        for (size_t page : pages) {
+            T**& directory = directories[page >> DIRECTORY_BITS];
+            if (directory != nullptr) {
+                directory_pool.Release(directory);
+                directory = nullptr;
+            }
+        }
+
+        pages.clear();
+    }
+
+    size_t used_bytes() {
+        return directories.size() * sizeof(T**) + pages.size() * sizeof(size_t);
+    }
+
+    size_t reserved_bytes() {
+        return directories.capacity() * sizeof(T**) + pages.capacity() * sizeof(size_t);
+    }
+};
+
+/// @brief Owns the open set and per-cell state of a search so it can be reused by successive PathFinders
+///
+/// Per-cell state is stored in fixed size pages handed out from a pool, a goal path only holds pages for the parts of
+/// the world it has touched. Reset and ClearGoalPath return pages to the pool instead of freeing them, so once a
+/// context has warmed up restarting a search (even on a different world) does not allocate and only costs as much as
+/// the search it forgets. Only one PathFinder may use a context at a time.
+class SearchContext {
+  public:
+    typedef std::tuple<float, int, Position> HeapTuple;
+
+  private:
+    static const size_t PAGES_PER_BLOCK = 64;
+
+    PagePool<SearchCell> cell_pages{PageTable<SearchCell>::PAGE_CELLS, PAGES_PER_BLOCK};
+    PagePool<SearchCell*> cell_directories{PageTable<SearchCell>::DIRECTORY_PAGES, PAGES_PER_BLOCK};
+    /// @brief One per goal path
+    std::vector<PageTable<SearchCell>> goal_path_cells;
+    size_t goal_path_count = 0;
+
+    /// @brief Expansions of each cell over every goal path, paged the same way
+    PagePool<int> check_pages{PageTable<int>::PAGE_CELLS, PAGES_PER_BLOCK};
+    PagePool<int*> check_directories{PageTable<int>::DIRECTORY_PAGES, PAGES_PER_BLOCK};
+    PageTable<int> check_counts;
+
+    std::vector<HeapTuple> open_set;
+
+  public:
+    /// @brief Forgets all search state and prepares for a world of cell_count cells searched along goal_path_count
+    /// goal paths, keeping every allocation
+    void Reset(size_t cell_count, size_t goal_path_count);
+
+    /// @return nullptr if the cell has never been reached on that goal path
+    SearchCell* find(int goal_path, PositionHashable cell);
+    SearchCell& at(int goal_path, PositionHashable cell);
+    /// @brief Forgets the per-cell state of a single goal path, its pages go back to the pool
+    void ClearGoalPath(int goal_path);
+
+    bool open_empty();
+    size_t open_size();
+    const HeapTuple& open_top();
+    void open_push(const HeapTuple& entry);
+    void open_pop();
+    /// @brief Drops every open set entry belonging to goal_path, in place
+    void open_remove_goal_path(int goal_path);
+
+    /// @return Times the cell was expanded since the last Reset
+    int checks(PositionHashable cell);
+    void AddCheck(PositionHashable cell);
+
+    /// @brief Bytes held for search state currently in use
+    size_t used_bytes();
+    /// @brief Bytes held by the context including pooled storage
+    size_t reserved_bytes();
+};
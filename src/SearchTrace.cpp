@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "SearchTrace.h"
+#include "Trace.h"
+
+// Every event starts with a varint whose low bits hold the kind and flags
+enum : uint64_t {
+    EVENT_EXPANSION = 0,
+    EVENT_GOAL_TRANSITION = 1,
+    EVENT_KIND_MASK = 3,
+    /// @brief Expansion is on a different goal path than the last one, the goal path follows
+    EVENT_GOAL_PATH_CHANGED = 4,
+    /// @brief The search started over before this expansion
+    EVENT_RESTART = 8,
+    EVENT_PAYLOAD_SHIFT = 4,
+};
+
+enum : uint8_t {
+    /// @brief Two bits per move, every step of the path is to a neighbor
+    PATH_PACKED_MOVES = 0,
+    /// @brief Zigzag varint offsets, for anything else
+    PATH_OFFSETS = 1,
+};
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static bool get_varint(const std::vector<uint8_t>& in, size_t& pos, size_t end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= end)
+            return false;
+
+        uint8_t byte = in[pos++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static uint64_t zigzag(int value) {
+    return ((uint64_t)(int64_t)value << 1) ^ (uint64_t)((int64_t)value >> 63);
+}
+
+static int unzigzag(uint64_t value) {
+    return (int)((int64_t)(value >> 1) ^ -(int64_t)(value & 1));
+}
+
+static void put_string(std::vector<uint8_t>& out, const std::string& value) {
+    put_varint(out, value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+static bool get_string(const std::vector<uint8_t>& in, size_t& pos, std::string& value) {
+    uint64_t length;
+    if (!get_varint(in, pos, in.size(), length) || length > in.size() - pos)
+        return false;
+
+    value.assign(in.begin() + pos, in.begin() + pos + length);
+    pos += length;
+
+    return true;
+}
+
+SearchTraceRecorder::SearchTraceRecorder(const WorldSnapshot& world, const std::string& map,
+                                         const std::string& algorithm)
+    : size(world.get_size()), map(map), algorithm(algorithm) {
+    checks.assign((size_t)size.first * size.second, 0);
+
+    TakeKeyframe();
+}
+
+void SearchTraceRecorder::TakeKeyframe() {
+    Keyframe keyframe;
+    keyframe.step = expansions;
+    keyframe.offset = events.size();
+    keyframe.position = position;
+    keyframe.goal_path = goal_path;
+    keyframe.goal_progress = goal_progress;
+
+    std::sort(touched.begin(), touched.end());
+    for (auto cell : touched)
+        keyframe.checks.push_back({cell, checks[cell]});
+
+    keyframes.push_back(keyframe);
+}
+
+void SearchTraceRecorder::RecordRestart() {
+    restart_pending = true;
+}
+
+void SearchTraceRecorder::RecordExpansion(int goal_path, Position position) {
+    if (expansions - keyframes.back().step >= std::max(SearchTrace::MIN_KEYFRAME_INTERVAL, touched.size() / 2))
+        TakeKeyframe();
+
+    uint64_t header = EVENT_EXPANSION | zigzag(position.first - this->position.first) << EVENT_PAYLOAD_SHIFT;
+    if (goal_path != this->goal_path)
+        header |= EVENT_GOAL_PATH_CHANGED;
+    if (restart_pending)
+        header |= EVENT_RESTART;
+
+    put_varint(events, header);
+    put_varint(events, zigzag(position.second - this->position.second));
+    if (goal_path != this->goal_path)
+        put_varint(events, goal_path);
+
+    if (restart_pending) {
+        for (auto cell : touched)
+            checks[cell] = 0;
+        touched.clear();
+        goal_progress.clear();
+
+        restart_pending = false;
+    }
+
+    this->position = position;
+    this->goal_path = goal_path;
+
+    PositionHashable cell = position.first * size.second + position.second;
+    if (checks[cell]++ == 0)
+        touched.push_back(cell);
+
+    expansions++;
+}
+
+void SearchTraceRecorder::RecordGoalTransition(int goal_path, int goal_progress) {
+    put_varint(events, EVENT_GOAL_TRANSITION | (uint64_t)goal_path << EVENT_PAYLOAD_SHIFT);
+    put_varint(events, goal_progress);
+
+    if (this->goal_progress.size() <= (size_t)goal_path)
+        this->goal_progress.resize(goal_path + 1, 0);
+    this->goal_progress[goal_path] = goal_progress;
+}
+
+void SearchTraceRecorder::Finish(bool completed, float cost, const std::deque<Position>& path) {
+    finished = true;
+    this->completed = completed;
+    this->cost = cost;
+    this->path = path;
+}
+
+size_t SearchTraceRecorder::step_count() {
+    return expansions;
+}
+
+size_t SearchTraceRecorder::Write(const char* filename) {
+    TRACE_SCOPE("SearchTraceRecorder::Write");
+
+    std::vector<uint8_t> out;
+
+    uint32_t magic = SearchTrace::MAGIC;
+    out.resize(sizeof(uint32_t));
+    memcpy(out.data(), &magic, sizeof(uint32_t));
+    put_varint(out, SearchTrace::VERSION);
+
+    put_varint(out, size.first);
+    put_varint(out, size.second);
+    put_string(out, map);
+    put_string(out, algorithm);
+    put_varint(out, expansions);
+
+    out.push_back(finished && completed ? 1 : 0);
+    uint32_t cost_bits;
+    memcpy(&cost_bits, &cost, sizeof(float));
+    put_varint(out, cost_bits);
+
+    put_varint(out, events.size());
+    out.insert(out.end(), events.begin(), events.end());
+
+    put_varint(out, keyframes.size());
+    for (auto& keyframe : keyframes) {
+        std::vector<uint8_t> body;
+        put_varint(body, keyframe.position.first);
+        put_varint(body, keyframe.position.second);
+        put_varint(body, keyframe.goal_path);
+
+        put_varint(body, keyframe.goal_progress.size());
+        for (auto progress : keyframe.goal_progress)
+            put_varint(body, progress);
+
+        put_varint(body, keyframe.checks.size());
+        PositionHashable last = 0;
+        for (auto cell : keyframe.checks) {
+            put_varint(body, cell.first - last);
+            put_varint(body, cell.second);
+            last = cell.first;
+        }
+
+        put_varint(out, keyframe.step);
+        put_varint(out, keyframe.offset);
+        put_varint(out, body.size());
+        out.insert(out.end(), body.begin(), body.end());
+    }
+
+    bool packable = true;
+    for (size_t i = 1; i < path.size(); i++)
+        packable = packable && distance(path[i - 1], path[i]) == 1;
+
+    out.push_back(packable ? PATH_PACKED_MOVES : PATH_OFFSETS);
+    put_varint(out, path.size());
+    if (!path.empty()) {
+        put_varint(out, path[0].first);
+        put_varint(out, path[0].second);
+    }
+
+    if (packable) {
+        uint8_t byte = 0;
+        for (size_t i = 1; i < path.size(); i++) {
+            int dx = path[i].first - path[i - 1].first;
+            int dy = path[i].second - path[i - 1].second;
+            uint8_t move = dx == 1 ? 0 : dx == -1 ? 1 : dy == 1 ? 2 : 3;
+
+            byte |= move << ((i - 1) % 4 * 2);
+            if ((i - 1) % 4 == 3 || i + 1 == path.size()) {
+                out.push_back(byte);
+                byte = 0;
+            }
+        }
+    } else {
+        for (size_t i = 1; i < path.size(); i++) {
+            put_varint(out, zigzag(path[i].first - path[i - 1].first));
+            put_varint(out, zigzag(path[i].second - path[i - 1].second));
+        }
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+    if (!file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+
+        return 0;
+    }
+
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    file.close();
+
+    if (!file) {
+        std::cerr << "Error writing " << filename << std::endl;
+
+        return 0;
+    }
+
+    return out.size();
+}
+
+bool SearchTracePlayer::Load(const char* filename) {
+    TRACE_SCOPE("SearchTracePlayer::Load");
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+
+        return false;
+    }
+
+    data.resize(file.tellg());
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    file.close();
+
+    uint32_t magic = 0;
+    if (data.size() >= sizeof(uint32_t))
+        memcpy(&magic, data.data(), sizeof(uint32_t));
+
+    size_t pos = sizeof(uint32_t);
+    uint64_t version, width, height, steps, cost_bits, events_size, keyframe_count;
+
+    if (magic != SearchTrace::MAGIC || !get_varint(data, pos, data.size(), version) ||
+        version != SearchTrace::VERSION) {
+        std::cerr << filename << " is not a search trace" << std::endl;
+
+        return false;
+    }
+
+    bool valid = get_varint(data, pos, data.size(), width) && get_varint(data, pos, data.size(), height) &&
+                 get_string(data, pos, map) && get_string(data, pos, algorithm) &&
+                 get_varint(data, pos, data.size(), steps) && pos < data.size();
+
+    if (valid) {
+        completed = data[pos++] == 1;
+        valid = get_varint(data, pos, data.size(), cost_bits) && get_varint(data, pos, data.size(), events_size) &&
+                events_size <= data.size() - pos;
+    }
+
+    if (valid) {
+        uint32_t bits = cost_bits;
+        memcpy(&cost, &bits, sizeof(float));
+
+        size = {(int)width, (int)height};
+        expansions = steps;
+        events_begin = pos;
+        events_end = pos + events_size;
+        pos = events_end;
+
+        valid = get_varint(data, pos, data.size(), keyframe_count);
+    }
+
+    keyframes.clear();
+    for (uint64_t i = 0; valid && i < keyframe_count; i++) {
+        uint64_t step, offset, body_size;
+        valid = get_varint(data, pos, data.size(), step) && get_varint(data, pos, data.size(), offset) &&
+                get_varint(data, pos, data.size(), body_size) && body_size <= data.size() - pos &&
+                offset <= events_size;
+
+        if (valid) {
+            keyframes.push_back({step, events_begin + offset, pos});
+            pos += body_size;
+        }
+    }
+
+    uint64_t path_size = 0;
+    uint8_t path_encoding = 0;
+    valid = valid && !keyframes.empty() && pos < data.size();
+    if (valid) {
+        path_encoding = data[pos++];
+        valid = get_varint(data, pos, data.size(), path_size);
+    }
+
+    path.clear();
+    if (valid && path_size > 0) {
+        uint64_t x = 0, y = 0;
+        valid = get_varint(data, pos, data.size(), x) && get_varint(data, pos, data.size(), y);
+        path.push_back({(int)x, (int)y});
+
+        for (uint64_t i = 1; valid && i < path_size; i++) {
+            Position next = path.back();
+
+            if (path_encoding == PATH_PACKED_MOVES) {
+                size_t byte = pos + (i - 1) / 4;
+                if (byte >= data.size()) {
+                    valid = false;
+                    break;
+                }
+
+                int move = (data[byte] >> ((i - 1) % 4 * 2)) & 3;
+                next.first += move == 0 ? 1 : move == 1 ? -1 : 0;
+                next.second += move == 2 ? 1 : move == 3 ? -1 : 0;
+            } else {
+                uint64_t dx = 0, dy = 0;
+                valid = get_varint(data, pos, data.size(), dx) && get_varint(data, pos, data.size(), dy);
+                next.first += unzigzag(dx);
+                next.second += unzigzag(dy);
+            }
+
+            path.push_back(next);
+        }
+    }
+
+    if (!valid) {
+        std::cerr << filename << " is a damaged search trace" << std::endl;
+
+        return false;
+    }
+
+    checks.assign((size_t)size.first * size.second, 0);
+    touched.clear();
+    LoadKeyframe(keyframes.front());
+
+    return true;
+}
+
+void SearchTracePlayer::LoadKeyframe(const KeyframeIndex& keyframe) {
+    for (auto cell : touched)
+        checks[cell] = 0;
+    touched.clear();
+
+    current_step = keyframe.step;
+    cursor = keyframe.offset;
+
+    // Bodies were bounds checked as a whole on load, a damaged one just leaves the state partly filled in
+    size_t pos = keyframe.body;
+    uint64_t x = 0, y = 0, path = 0, count = 0;
+    get_varint(data, pos, data.size(), x);
+    get_varint(data, pos, data.size(), y);
+    get_varint(data, pos, data.size(), path);
+    position = {(int)x, (int)y};
+    goal_path = path;
+
+    goal_progress.clear();
+    if (get_varint(data, pos, data.size(), count)) {
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t progress;
+            if (!get_varint(data, pos, data.size(), progress))
+                break;
+            goal_progress.push_back(progress);
+        }
+    }
+
+    PositionHashable cell = 0;
+    if (get_varint(data, pos, data.size(), count)) {
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t delta, value;
+            if (!get_varint(data, pos, data.size(), delta) || !get_varint(data, pos, data.size(), value))
+                break;
+
+            cell += delta;
+            if (cell < 0 || (size_t)cell >= checks.size())
+                break;
+
+            checks[cell] = value;
+            touched.push_back(cell);
+        }
+    }
+}
+
+bool SearchTracePlayer::Advance(size_t step) {
+    size_t pos = cursor;
+    uint64_t header;
+    if (!get_varint(data, pos, events_end, header))
+        return false;
+
+    if ((header & EVENT_KIND_MASK) == EVENT_EXPANSION) {
+        if (current_step >= step)
+            return false;
+
+        uint64_t dy, path = goal_path;
+        if (!get_varint(data, pos, events_end, dy))
+            return false;
+        if ((header & EVENT_GOAL_PATH_CHANGED) && !get_varint(data, pos, events_end, path))
+            return false;
+
+        if (header & EVENT_RESTART) {
+            for (auto cell : touched)
+                checks[cell] = 0;
+            touched.clear();
+            goal_progress.clear();
+        }
+
+        position.first += unzigzag(header >> EVENT_PAYLOAD_SHIFT);
+        position.second += unzigzag(dy);
+        goal_path = path;
+
+        if (position.first < 0 || position.first >= size.first || position.second < 0 || position.second >= size.second)
+            return false;
+
+        PositionHashable cell = position.first * size.second + position.second;
+        if (checks[cell]++ == 0)
+            touched.push_back(cell);
+
+        current_step++;
+    } else {
+        uint64_t progress;
+        if (!get_varint(data, pos, events_end, progress))
+            return false;
+
+        size_t path = header >> EVENT_PAYLOAD_SHIFT;
+        if (goal_progress.size() <= path)
+            goal_progress.resize(path + 1, 0);
+        goal_progress[path] = progress;
+    }
+
+    cursor = pos;
+
+    return true;
+}
+
+void SearchTracePlayer::Seek(size_t step) {
+    if (keyframes.empty())
+        return;
+
+    TRACE_SCOPE("SearchTracePlayer::Seek");
+
+    step = std::min(step, expansions);
+
+    // Latest keyframe at or before step
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), step,
+                                     [](size_t step, const KeyframeIndex& keyframe) { return step < keyframe.step; });
+    keyframe--;
+
+    // Carry on from where we are when that is at least as close
+    if (current_step > step || current_step < keyframe->step)
+        LoadKeyframe(*keyframe);
+
+    while (Advance(step)) {
+    }
+}
+
+const std::string& SearchTracePlayer::get_map() {
+    return map;
+}
+
+const std::string& SearchTracePlayer::get_algorithm() {
+    return algorithm;
+}
+
+std::pair<int, int> SearchTracePlayer::get_size() {
+    return size;
+}
+
+size_t SearchTracePlayer::step_count() {
+    return expansions;
+}
+
+size_t SearchTracePlayer::get_step() {
+    return current_step;
+}
+
+Position SearchTracePlayer::get_current_position() {
+    return position;
+}
+
+int SearchTracePlayer::get_goal_path() {
+    return goal_path;
+}
+
+int SearchTracePlayer::get_goal_progress() {
+    if ((size_t)goal_path < goal_progress.size())
+        return goal_progress[goal_path];
+
+    return 0;
+}
+
+int SearchTracePlayer::get_checks(Position pos) {
+    if (pos.first < 0 || pos.first >= size.first || pos.second < 0 || pos.second >= size.second)
+        return 0;
+
+    return checks[pos.first * size.second + pos.second];
+}
+
+bool SearchTracePlayer::search_completed() {
+    return completed;
+}
+
+float SearchTracePlayer::get_cost() {
+    return cost;
+}
+
+const std::deque<Position>& SearchTracePlayer::get_path() {
+    return path;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "WorldSnapshot.h"
+
+/// @brief Compact binary recording of a search, for watching heavy solves after they ran headless
+///
+/// The trace is a byte stream of varint events: each expansion stores its offset from the one before, goal path
+/// changes and goal transitions are only stored when they happen, and the final path is packed two bits per move.
+/// Keyframes of the check count heatmap let playback jump anywhere without replaying from the start. A keyframe is
+/// taken once the expansions since the last one outnumber half the cells it would hold, so keyframes never cost more
+/// than the events between them and a seek never replays more than that.
+namespace SearchTrace {
+const uint32_t MAGIC = 0x54525341; // "ASRT"
+const int VERSION = 1;
+/// @brief Fewest expansions between keyframes
+const size_t MIN_KEYFRAME_INTERVAL = 4096;
+} // namespace SearchTrace
+
+/// @brief Fed by a PathFinder through PathFinder::set_recorder, then written out once the search is over
+class SearchTraceRecorder {
+  private:
+    std::pair<int, int> size;
+    std::string map;
+    std::string algorithm;
+
+    std::vector<uint8_t> events;
+    size_t expansions = 0;
+
+    struct Keyframe {
+        size_t step;
+        size_t offset;
+        Position position;
+        int goal_path;
+        std::vector<int> goal_progress;
+        /// @brief Sorted hashables with their check counts
+        std::vector<std::pair<PositionHashable, int>> checks;
+    };
+    std::vector<Keyframe> keyframes;
+
+    // State at the end of the events so far
+    Position position = {0, 0};
+    int goal_path = 0;
+    std::vector<int> goal_progress;
+    std::vector<int> checks;
+    std::vector<PositionHashable> touched;
+    bool restart_pending = false;
+
+    bool finished = false;
+    bool completed = false;
+    float cost = 0;
+    std::deque<Position> path;
+
+    void TakeKeyframe();
+
+  public:
+    SearchTraceRecorder(const WorldSnapshot& world, const std::string& map, const std::string& algorithm);
+
+    /// @brief The search started over (a new anytime iteration), checks are cleared from the next expansion on
+    void RecordRestart();
+    void RecordExpansion(int goal_path, Position position);
+    void RecordGoalTransition(int goal_path, int goal_progress);
+    /// @param path IN REVERSE ORDER, like PathFinder::get_best_path
+    void Finish(bool completed, float cost, const std::deque<Position>& path);
+
+    size_t step_count();
+    /// @brief Writes the whole trace in one go
+    /// @return Bytes written, 0 on failure
+    size_t Write(const char* filename);
+};
+
+/// @brief Seeks through a recorded trace
+class SearchTracePlayer {
+  private:
+    std::vector<uint8_t> data;
+
+    std::pair<int, int> size;
+    std::string map;
+    std::string algorithm;
+    size_t expansions = 0;
+    bool completed = false;
+    float cost = 0;
+    std::deque<Position> path;
+
+    size_t events_begin = 0;
+    size_t events_end = 0;
+
+    struct KeyframeIndex {
+        size_t step;
+        size_t offset;
+        /// @brief Where the keyframe's state is stored in data
+        size_t body;
+    };
+    std::vector<KeyframeIndex> keyframes;
+
+    // State after current_step expansions
+    size_t current_step = 0;
+    size_t cursor = 0;
+    Position position = {0, 0};
+    int goal_path = 0;
+    std::vector<int> goal_progress;
+    std::vector<int> checks;
+    /// @brief Cells with a check, so jumping to a keyframe clears them without sweeping the whole world
+    std::vector<PositionHashable> touched;
+
+    void LoadKeyframe(const KeyframeIndex& keyframe);
+    /// @brief Applies the next event, false once the stream is exhausted or the next expansion would pass step
+    bool Advance(size_t step);
+
+  public:
+    /// @return false if the file is missing or not a trace
+    bool Load(const char* filename);
+
+    const std::string& get_map();
+    const std::string& get_algorithm();
+    std::pair<int, int> get_size();
+
+    size_t step_count();
+    size_t get_step();
+    /// @brief Moves to the state after step expansions, going backwards costs no more than going forwards
+    void Seek(size_t step);
+
+    Position get_current_position();
+    int get_goal_path();
+    int get_goal_progress();
+    int get_checks(Position pos);
+
+    /// @brief Whether the recorded search found its path
+    bool search_completed();
+    float get_cost();
+    /// @return The final path, IN REVERSE ORDER
+    const std::deque<Position>& get_path();
+};
@@ -0,0 +1,75 @@
+#include <cmath>
+
+#include "Terrain.h"
+
+TerrainPalette::TerrainPalette() {
+    // Colors are raylib's
+    classes = {
+        {"Default", 1.0f, true, Tile::Sand, {80, 80, 80, 255}},
+        {"Path", 1.0f, true, Tile::Sand, {80, 80, 80, 255}},
+        {"Zelda Black", 1.0078125f, true, Tile::Black, {0, 0, 0, 255}},
+        {"Bridge", 1.5f, true, Tile::Bridge, {211, 176, 131, 255}},
+        {"Grass", 2.0f, true, Tile::Grass, {0, 228, 48, 255}},
+        {"River", 10.0f, true, Tile::River, {0, 121, 241, 255}},
+        {"Tree", 1001.0f, false, Tile::Tree, {127, 106, 79, 255}},
+        {"Zelda Rock", 1200.0f, false, Tile::ZeldaRock, {0, 0, 0, 255}},
+        {"Black Wall", 1221.0f, false, Tile::Black, {0, 0, 0, 255}},
+        {"Zelda Flame", 1532.0f, false, Tile::Flame, {0, 0, 0, 255}},
+        {"Zelda Sword", 2556.0f, false, Tile::Sword, {0, 0, 0, 255}},
+    };
+}
+
+size_t TerrainPalette::size() const {
+    return classes.size();
+}
+
+const Terrain& TerrainPalette::operator[](TerrainClass terrain) const {
+    return classes[terrain];
+}
+
+int TerrainPalette::find(float weight) const {
+    for (size_t i = DEFAULT_CLASS + 1; i < classes.size(); i++) {
+        if (classes[i].weight == weight)
+            return i;
+    }
+
+    return -1;
+}
+
+int TerrainPalette::ClassFor(float weight) {
+    if (std::isnan(weight))
+        return DEFAULT_CLASS;
+
+    int existing = find(weight);
+    if (existing != -1)
+        return existing;
+
+    if (classes.size() >= MAX_CLASSES)
+        return -1;
+
+    bool passable = weight < IMPASSABLE_WEIGHT;
+    classes.push_back({"Weight " + std::to_string(weight), weight, passable, Tile::Black, {0, 228, 48, 255}});
+
+    return classes.size() - 1;
+}
+
+TerrainClass TerrainPalette::nearest(float weight) const {
+    bool passable = weight < IMPASSABLE_WEIGHT;
+
+    size_t closest = DEFAULT_CLASS + 1;
+    float closest_difference = INFINITY;
+    for (size_t i = DEFAULT_CLASS + 1; i < classes.size(); i++) {
+        float difference = std::fabs(classes[i].weight - weight);
+        if (classes[i].passable == passable && difference < closest_difference) {
+            closest = i;
+            closest_difference = difference;
+        }
+    }
+
+    return closest;
+}
+
+void TerrainPalette::set_weight(TerrainClass terrain, float weight, bool passable) {
+    classes[terrain].weight = weight;
+    classes[terrain].passable = passable;
+}
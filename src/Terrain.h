@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief Weights at or above this are impassable when a terrain is made from a bare weight, like the ones in world
+/// files
+const float IMPASSABLE_WEIGHT = 1000;
+
+/// @brief Every tile the renderer draws, the terrain as well as the markers
+enum class Tile {
+    Sand,
+    Black,
+    Bridge,
+    Grass,
+    River,
+    Tree,
+    ZeldaRock,
+    Flame,
+    Sword,
+    Coin,
+    Gem,
+    OldMan,
+    Alberta,
+    Count,
+};
+
+/// @brief Index into a TerrainPalette, what a world stores per cell
+typedef uint8_t TerrainClass;
+
+struct Terrain {
+    std::string name;
+    /// @brief Cost of moving into a cell of this terrain
+    float weight;
+    bool passable;
+    Tile tile;
+    /// @brief RGBA, stands in for the tile when zoomed out too far to draw it
+    uint8_t color[4];
+};
+
+/// @brief What each terrain class costs, whether it can be walked and how it is drawn, so the solver and renderer
+/// read the same table and rebalancing a terrain is one edit instead of rewriting every cell
+///
+/// Class 0 is the default terrain of cells that were never set. World files only hold weights, so cells read from
+/// them get the first class with exactly that weight, and a weight no class has yet gets a new plain class.
+class TerrainPalette {
+  public:
+    static const int MAX_CLASSES = 256;
+    static const TerrainClass DEFAULT_CLASS = 0;
+
+  private:
+    std::vector<Terrain> classes;
+
+  public:
+    /// @brief The default terrain plus every terrain the shipped worlds use
+    TerrainPalette();
+
+    size_t size() const;
+    const Terrain& operator[](TerrainClass terrain) const;
+
+    /// @return First class after DEFAULT_CLASS with exactly weight, -1 if there is none
+    int find(float weight) const;
+    /// @brief Class of weight, adding one if none has it. Only NaN, the weight of a cell that was never set, gives
+    /// DEFAULT_CLASS.
+    /// @return -1 if weight needs a new class and all MAX_CLASSES are taken
+    int ClassFor(float weight);
+    /// @brief Class with the closest weight and the passability a bare weight gets, for cells that must get some
+    /// class once the palette is full
+    TerrainClass nearest(float weight) const;
+    void set_weight(TerrainClass terrain, float weight, bool passable);
+};
@@ -0,0 +1,93 @@
+#include <iostream>
+
+#include "TileAtlas.h"
+#include "Trace.h"
+
+namespace {
+/// @brief File names in the order of Tile
+const char* const TILE_FILES[] = {"sand",  "black", "bridge", "grass", "river",  "tree",   "Z_rock",
+                                  "flame", "sword", "coin",   "gem",   "oldman", "alberta"};
+
+static_assert(sizeof(TILE_FILES) / sizeof(*TILE_FILES) == (size_t)Tile::Count, "Every tile needs a file");
+} // namespace
+
+TileAtlas::~TileAtlas() {
+    Unload();
+}
+
+void TileAtlas::Unload() {
+    if (texture.id != 0)
+        UnloadTexture(texture);
+
+    texture = {};
+}
+
+bool TileAtlas::Load(const std::string& tiles_path) {
+    TRACE_SCOPE("TileAtlas::Load");
+
+    Unload();
+
+    const int sizes[] = {LARGE_SIZE, SMALL_SIZE};
+    const int count = (int)Tile::Count;
+
+    Image atlas = GenImageColor(count * (LARGE_SIZE + 2 * PADDING), LARGE_SIZE + SMALL_SIZE + 4 * PADDING, BLANK);
+    bool complete = true;
+
+    float row = 0;
+    for (int small = 0; small < 2; small++) {
+        float size = sizes[small];
+
+        for (int i = 0; i < count; i++) {
+            float x = i * (size + 2 * PADDING) + PADDING;
+            float y = row + PADDING;
+            sources[small][i] = {x, y, size, size};
+
+            std::string filename = tiles_path + std::to_string(sizes[small]) + "/" + TILE_FILES[i] + ".png";
+            Image tile = LoadImage(filename.c_str());
+
+            if (tile.data == nullptr) {
+                std::cerr << "Error loading tile " << filename << std::endl;
+                complete = false;
+
+                continue;
+            }
+
+            float w = tile.width;
+            float h = tile.height;
+
+            ImageDraw(&atlas, tile, {0, 0, w, h}, {x, y, size, size}, WHITE);
+
+            // Extrude the edges, then the corners
+            ImageDraw(&atlas, tile, {0, 0, w, 1}, {x, y - PADDING, size, PADDING}, WHITE);
+            ImageDraw(&atlas, tile, {0, h - 1, w, 1}, {x, y + size, size, PADDING}, WHITE);
+            ImageDraw(&atlas, tile, {0, 0, 1, h}, {x - PADDING, y, PADDING, size}, WHITE);
+            ImageDraw(&atlas, tile, {w - 1, 0, 1, h}, {x + size, y, PADDING, size}, WHITE);
+            ImageDraw(&atlas, tile, {0, 0, 1, 1}, {x - PADDING, y - PADDING, PADDING, PADDING}, WHITE);
+            ImageDraw(&atlas, tile, {w - 1, 0, 1, 1}, {x + size, y - PADDING, PADDING, PADDING}, WHITE);
+            ImageDraw(&atlas, tile, {0, h - 1, 1, 1}, {x - PADDING, y + size, PADDING, PADDING}, WHITE);
+            ImageDraw(&atlas, tile, {w - 1, h - 1, 1, 1}, {x + size, y + size, PADDING, PADDING}, WHITE);
+
+            UnloadImage(tile);
+        }
+
+        row += size + 2 * PADDING;
+    }
+
+    texture = LoadTextureFromImage(atlas);
+    SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+    UnloadImage(atlas);
+
+    return complete;
+}
+
+Texture2D TileAtlas::get_texture() {
+    return texture;
+}
+
+Rectangle TileAtlas::source(Tile tile, bool small) {
+    return sources[small ? 1 : 0][(int)tile];
+}
+
+void TileAtlas::Draw(Tile tile, bool small, Rectangle destination, Color tint) {
+    DrawTexturePro(texture, source(tile, small), destination, {0, 0}, 0, tint);
+}
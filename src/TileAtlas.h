@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "Terrain.h"
+#include "raylib.h"
+
+/// @brief All tile textures packed into a single texture, so a frame of tiles is one batched draw instead of a texture
+/// switch per tile
+///
+/// The 32 pixel tiles fill the top row and the 16 pixel ones the row under them. Each tile is surrounded by a copy of
+/// its own edge pixels, so sampling just outside a source rectangle when scaling never picks up the neighboring tile.
+class TileAtlas {
+  public:
+    /// @brief Pixels of extruded edge around each tile
+    static const int PADDING = 1;
+    static const int LARGE_SIZE = 32;
+    static const int SMALL_SIZE = 16;
+
+  private:
+    Texture2D texture = {};
+    /// @brief Where each tile sits in the texture, [0] for the large tiles and [1] for the small ones
+    Rectangle sources[2][(int)Tile::Count];
+
+  public:
+    ~TileAtlas();
+
+    /// @brief Packs <tiles_path>/32/<name>.png and <tiles_path>/16/<name>.png and uploads them in one go, missing
+    /// tiles are reported and left transparent
+    /// @return false if any tile was missing
+    bool Load(const std::string& tiles_path);
+    /// @brief Must be called before the window closes
+    void Unload();
+
+    Texture2D get_texture();
+    Rectangle source(Tile tile, bool small);
+
+    void Draw(Tile tile, bool small, Rectangle destination, Color tint = WHITE);
+};
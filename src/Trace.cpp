@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+#ifdef ALBERTA_TRACE
+
+namespace {
+struct TraceEvent {
+    const char* name;
+    double start_us;
+    double duration_us;
+};
+
+// Each thread records into its own buffer so timers on worker threads never contend on a shared lock, the session
+// only walks every buffer when it is written out
+struct ThreadBuffer {
+    int thread_id;
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+
+    ThreadBuffer();
+    ~ThreadBuffer();
+};
+
+std::mutex session_mutex;
+std::atomic<bool> session_active(false);
+std::string session_filename;
+std::chrono::steady_clock::time_point session_start;
+std::vector<ThreadBuffer*> thread_buffers;
+// Events from threads that exited before the session ended
+std::vector<std::pair<int, TraceEvent>> orphaned_events;
+int next_thread_id = 1;
+
+ThreadBuffer::ThreadBuffer() {
+    std::lock_guard<std::mutex> lock(session_mutex);
+
+    thread_id = next_thread_id++;
+    thread_buffers.push_back(this);
+}
+
+ThreadBuffer::~ThreadBuffer() {
+    std::lock_guard<std::mutex> lock(session_mutex);
+
+    for (auto event : events)
+        orphaned_events.push_back({thread_id, event});
+    thread_buffers.erase(std::remove(thread_buffers.begin(), thread_buffers.end(), this), thread_buffers.end());
+}
+
+ThreadBuffer& current_thread_buffer() {
+    thread_local ThreadBuffer buffer;
+
+    return buffer;
+}
+} // namespace
+
+bool Trace::BeginSession(const char* filename) {
+    std::lock_guard<std::mutex> lock(session_mutex);
+
+    if (session_active) {
+        std::cerr << "Trace session already running, ignoring " << filename << std::endl;
+
+        return false;
+    }
+
+    session_filename = filename;
+    session_start = std::chrono::steady_clock::now();
+    orphaned_events.clear();
+    for (auto buffer : thread_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+    }
+
+    session_active = true;
+
+    return true;
+}
+
+void Trace::EndSession() {
+    std::lock_guard<std::mutex> lock(session_mutex);
+
+    if (!session_active)
+        return;
+
+    session_active = false;
+
+    std::vector<std::pair<int, TraceEvent>> events;
+    events.swap(orphaned_events);
+    for (auto buffer : thread_buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+
+        for (auto event : buffer->events)
+            events.push_back({buffer->thread_id, event});
+        buffer->events.clear();
+        buffer->events.shrink_to_fit();
+    }
+
+    std::ofstream file(session_filename);
+
+    if (!file.is_open()) {
+        std::cerr << "Error opening trace file!" << std::endl;
+
+        return;
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceEvent& event = events[i].second;
+
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\": \"" << event.name
+             << "\", \"cat\": \"alberta\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << events[i].first
+             << ", \"ts\": " << event.start_us << ", \"dur\": " << event.duration_us << "}";
+    }
+    file << "\n]}\n";
+}
+
+void Trace::RecordEvent(const char* name, std::chrono::steady_clock::time_point start,
+                        std::chrono::steady_clock::time_point end) {
+    if (!session_active)
+        return;
+
+    ThreadBuffer& buffer = current_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+
+    buffer.events.push_back({name, std::chrono::duration<double, std::micro>(start - session_start).count(),
+                             std::chrono::duration<double, std::micro>(end - start).count()});
+}
+
+#else
+
+bool Trace::BeginSession(const char* filename) {
+    std::cerr << "Tracing was compiled out, rebuild with -DALBERTA_TRACE=ON to write " << filename << std::endl;
+
+    return false;
+}
+
+void Trace::EndSession() {}
+
+void Trace::RecordEvent(const char*, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point) {}
+
+#endif
+
+Trace::ScopedTimer::ScopedTimer(const char* name) : name(name), start(std::chrono::steady_clock::now()) {}
+
+Trace::ScopedTimer::~ScopedTimer() {
+    RecordEvent(name, start, std::chrono::steady_clock::now());
+}
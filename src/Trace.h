@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+
+/// @brief Scoped timers that record Chrome trace-event JSON (open with chrome://tracing or ui.perfetto.dev)
+///
+/// Only compiled in when ALBERTA_TRACE is defined (cmake -DALBERTA_TRACE=ON), otherwise TRACE_SCOPE expands to
+/// nothing and the session functions do nothing.
+namespace Trace {
+/// @return false if tracing was compiled out or a session is already running
+bool BeginSession(const char* filename);
+/// @brief Writes every recorded event to the session file
+void EndSession();
+
+void RecordEvent(const char* name, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end);
+
+class ScopedTimer {
+  private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    /// @param name Must outlive the session, string literals only
+    ScopedTimer(const char* name);
+    ~ScopedTimer();
+};
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef ALBERTA_TRACE
+#define TRACE_SCOPE(name) Trace::ScopedTimer TRACE_CONCAT(trace_timer_, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
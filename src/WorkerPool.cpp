@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int threads) : next_index(0) {
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < threads; i++)
+        workers.push_back(std::thread(&WorkerPool::Work, this, i));
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int WorkerPool::thread_count() {
+    return workers.size() + 1;
+}
+
+void WorkerPool::RunChunks(int worker) {
+    while (true) {
+        size_t begin = next_index.fetch_add(job_chunk);
+        if (begin >= job_count)
+            return;
+
+        job(begin, std::min(job_count, begin + job_chunk), worker);
+    }
+}
+
+void WorkerPool::Work(int worker) {
+    size_t seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+
+            if (stopping)
+                return;
+
+            seen = generation;
+        }
+
+        RunChunks(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0)
+            done.notify_one();
+    }
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t chunk, std::function<void(size_t, size_t, int)> work) {
+    if (count == 0)
+        return;
+
+    // Not worth waking anyone for a single chunk
+    if (workers.empty() || count <= chunk) {
+        work(0, count, 0);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = work;
+        job_count = count;
+        job_chunk = std::max<size_t>(1, chunk);
+        next_index = 0;
+        busy = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    RunChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return busy == 0; });
+}
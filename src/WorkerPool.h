@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Threads kept alive between parallel loops, for work split into many short phases where starting threads
+/// each time would cost more than the work itself
+class WorkerPool {
+  private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    /// @brief Bumped for every loop, workers run once per generation
+    size_t generation = 0;
+    int busy = 0;
+    bool stopping = false;
+
+    std::function<void(size_t, size_t, int)> job;
+    size_t job_count = 0;
+    size_t job_chunk = 1;
+    std::atomic<size_t> next_index;
+
+    void Work(int worker);
+    void RunChunks(int worker);
+
+  public:
+    /// @param threads Total threads including the caller, 0 for one per hardware thread
+    WorkerPool(int threads = 0);
+    ~WorkerPool();
+
+    int thread_count();
+
+    /// @brief Calls work(begin, end, worker) over chunks of [0, count) on every thread including the caller, returns
+    /// once all of them are done. worker is below thread_count() and unique among concurrent calls.
+    void ParallelFor(size_t count, size_t chunk, std::function<void(size_t, size_t, int)> work);
+};
@@ -1,34 +1,48 @@
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <unordered_map>
 #include <utility>
 
+#include "Trace.h"
 #include "World.h"
 
-int distance(Position a, Position b) {
-    return abs(a.first - b.first) + abs(a.second - b.second);
-}
+/// @brief Marks the generation stored after a world file's weights
+static const int WORLD_FILE_GENERATION = 0x4e454757;
+
+/// @brief Union-find nodes are never collected below this many, or below one per this many cells
+static const size_t MIN_COMPONENT_COLLECT = 1024;
+static const size_t CELLS_PER_COMPONENT_COLLECT = 16;
 
 World::World(std::pair<int, int> size, Position spawn, Position destination) {
-    this->size = size;
-    this->spawn = spawn;
-    this->destination = destination;
+    state.size = size;
+    state.spawn = spawn;
+    state.destination = destination;
+
+    AllocateChunks();
 }
 
 World::~World() {
-    if (locked)
-        std::cerr << "World is locked, baaaddddd **** may go down" << std::endl;
+    WaitForCompaction();
 }
 
-World::World(const char* filename) {
+World::World(const char* filename, bool journal_edits) {
+    TRACE_SCOPE("World::World(filename)");
+
     std::ifstream file(filename, std::ios::binary);
 
     if (!file.is_open()) {
         std::cerr << "Error opening file!" << std::endl;
 
-        size = {1, 2};
-        spawn = {0, 0};
-        destination = {0, 1};
+        state.size = {1, 2};
+        state.spawn = {0, 0};
+        state.destination = {0, 1};
+
+        AllocateChunks();
 
         return;
     }
@@ -36,17 +50,17 @@ World::World(const char* filename) {
     int width, height;
     file.read(reinterpret_cast<char*>(&width), sizeof(int));
     file.read(reinterpret_cast<char*>(&height), sizeof(int));
-    size = {width, height};
+    state.size = {width, height};
 
     int spawn_x, spawn_y;
     file.read(reinterpret_cast<char*>(&spawn_x), sizeof(int));
     file.read(reinterpret_cast<char*>(&spawn_y), sizeof(int));
-    spawn = {spawn_x, spawn_y};
+    state.spawn = {spawn_x, spawn_y};
 
     int destination_x, destination_y;
     file.read(reinterpret_cast<char*>(&destination_x), sizeof(int));
     file.read(reinterpret_cast<char*>(&destination_y), sizeof(int));
-    destination = {destination_x, destination_y};
+    state.destination = {destination_x, destination_y};
 
     int goals_count;
     file.read(reinterpret_cast<char*>(&goals_count), sizeof(int));
@@ -54,186 +68,1012 @@ World::World(const char* filename) {
         int goal_x, goal_y;
         file.read(reinterpret_cast<char*>(&goal_x), sizeof(int));
         file.read(reinterpret_cast<char*>(&goal_y), sizeof(int));
-        goals.push_back({goal_x, goal_y});
+        state.goals.push_back({goal_x, goal_y});
     }
 
+    AllocateChunks();
+
+    // Weights are stored a column at a time, read each column in one go and scatter its terrain classes into the
+    // chunks. Neighboring cells mostly share a weight, so only look the class up when it changes.
+    TerrainPalette& palette = MutablePalette();
+    float last_weight = std::numeric_limits<float>::quiet_NaN();
+    TerrainClass last_class = TerrainPalette::DEFAULT_CLASS;
+    bool last_nearest = false;
+    size_t nearest_cells = 0;
+
+    std::vector<float> column(height);
     for (int x = 0; x < width; x++) {
+        file.read(reinterpret_cast<char*>(column.data()), height * sizeof(float));
+
         for (int y = 0; y < height; y++) {
-            float weight;
-            file.read(reinterpret_cast<char*>(&weight), sizeof(float));
-            weighted_map[get_position_hashable({x, y})] = weight;
+            if (column[y] != last_weight) {
+                last_weight = column[y];
+                int terrain = palette.ClassFor(last_weight);
+                last_nearest = terrain == -1;
+                last_class = last_nearest ? palette.nearest(last_weight) : terrain;
+            }
+
+            if (last_nearest)
+                nearest_cells++;
+
+            MutableChunk({x, y}).terrain[WorldSnapshot::cell_index({x, y})] = last_class;
         }
     }
 
+    // Loading has to give every cell some class, but the costs are no longer the file's
+    if (nearest_cells > 0)
+        std::cerr << "Warning: " << filename << " has more than " << TerrainPalette::MAX_CLASSES
+                  << " different weights, " << nearest_cells << " cells were given the nearest weight the palette has"
+                  << std::endl;
+
+    // Files that were never compacted end with the weights
+    int trailer[2];
+    file.read(reinterpret_cast<char*>(trailer), sizeof(trailer));
+    if (file && trailer[0] == WORLD_FILE_GENERATION)
+        generation = trailer[1];
+
     file.close();
+
+    this->filename = filename;
+
+    // Records left parked by a compaction that never finished come first, they are older than the journal's
+    WorldJournal::Replay(WorldJournal::CompactingPathFor(this->filename), this, generation);
+    WorldJournal::Replay(WorldJournal::PathFor(this->filename), this, generation);
+
+    if (journal_edits)
+        journal.reset(new WorldJournal(WorldJournal::PathFor(this->filename)));
 }
 
-void World::save_world(const char* filename) {
-    std::ofstream file(filename, std::ios::binary);
+/// @brief Writes the .dat layout with a single write into a temporary file, then swaps it in
+/// @param generation Written after the weights unless 0, readers that only know the old layout stop before it
+static bool write_world_file(const WorldSnapshot& world, const std::string& filename, int generation) {
+    std::pair<int, int> size = world.get_size();
+
+    std::vector<int> header = {size.first,
+                               size.second,
+                               world.get_spawn().first,
+                               world.get_spawn().second,
+                               world.get_destination().first,
+                               world.get_destination().second,
+                               (int)world.get_goals().size()};
+    for (auto goal : world.get_goals()) {
+        header.push_back(goal.first);
+        header.push_back(goal.second);
+    }
+
+    size_t header_bytes = header.size() * sizeof(int);
+    size_t weight_bytes = (size_t)size.first * size.second * sizeof(float);
+    int trailer[2] = {WORLD_FILE_GENERATION, generation};
+    size_t trailer_bytes = generation != 0 ? sizeof(trailer) : 0;
+
+    std::vector<char> buffer(header_bytes + weight_bytes + trailer_bytes);
+    memcpy(buffer.data(), header.data(), header_bytes);
+
+    float* weights = reinterpret_cast<float*>(buffer.data() + header_bytes);
+    for (int x = 0; x < size.first; x++) {
+        for (int y = 0; y < size.second; y++)
+            *weights++ = world.get_weight({x, y});
+    }
+
+    memcpy(buffer.data() + header_bytes + weight_bytes, trailer, trailer_bytes);
+
+    std::string temp_filename = filename + ".tmp";
+    std::ofstream file(temp_filename, std::ios::binary | std::ios::trunc);
 
     if (!file.is_open()) {
         std::cerr << "Error opening file!" << std::endl;
 
+        return false;
+    }
+
+    file.write(buffer.data(), buffer.size());
+    file.close();
+
+    if (!file) {
+        std::cerr << "Error writing " << temp_filename << std::endl;
+        std::remove(temp_filename.c_str());
+
+        return false;
+    }
+
+    if (!replace_file(temp_filename, filename)) {
+        std::cerr << "Error replacing " << filename << std::endl;
+        std::remove(temp_filename.c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+void World::save_world(const char* filename) {
+    TRACE_SCOPE("World::save_world");
+
+    // Keeps the generation, a parked journal next to filename must still be skipped
+    write_world_file(*snapshot(), filename, generation);
+}
+
+void World::Compact() {
+    if (filename.empty()) {
+        std::cerr << "Only worlds loaded from a file can be compacted" << std::endl;
+
         return;
     }
 
-    int width = size.first;
-    int height = size.second;
-    file.write(reinterpret_cast<char*>(&width), sizeof(int));
-    file.write(reinterpret_cast<char*>(&height), sizeof(int));
+    WaitForCompaction();
 
-    int spawn_x = spawn.first;
-    int spawn_y = spawn.second;
-    file.write(reinterpret_cast<char*>(&spawn_x), sizeof(int));
-    file.write(reinterpret_cast<char*>(&spawn_y), sizeof(int));
+    TRACE_SCOPE("World::Compact");
 
-    int destination_x = destination.first;
-    int destination_y = destination.second;
-    file.write(reinterpret_cast<char*>(&destination_x), sizeof(int));
-    file.write(reinterpret_cast<char*>(&destination_y), sizeof(int));
+    std::shared_ptr<const WorldSnapshot> version = snapshot();
 
-    int goals_count = goals.size();
-    file.write(reinterpret_cast<char*>(&goals_count), sizeof(int));
-    for (auto goal : goals) {
-        int goal_x = goal.first;
-        int goal_y = goal.second;
-        file.write(reinterpret_cast<char*>(&goal_x), sizeof(int));
-        file.write(reinterpret_cast<char*>(&goal_y), sizeof(int));
+    // Every record so far is part of version, park them until the file holding version is in place. Edits made from
+    // here on start a fresh journal.
+    if (journal)
+        journal->Close();
+    std::string compacting_path = WorldJournal::CompactingPathFor(filename);
+    if (!WorldJournal::MoveRecords(WorldJournal::PathFor(filename), compacting_path))
+        return;
+
+    // Once the new file is in place a reload skips the parked records even if they were never dropped, replaying
+    // them over a file that already holds them is not harmless
+    generation++;
+    WorldJournal parked(compacting_path);
+    parked.RecordCompaction(generation);
+    parked.Close();
+
+    // The parked records and their COMPACTED record have to be on disk before the file that holds them replaces the
+    // old one, or a power loss could leave the new file next to records that replay over it
+    if (!sync_file(compacting_path)) {
+        std::cerr << "Error syncing " << compacting_path << ", not compacting" << std::endl;
+
+        return;
     }
 
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            float weight = get_weight({x, y});
-            file.write(reinterpret_cast<char*>(&weight), sizeof(float));
-        }
+    std::string target = filename;
+    int target_generation = generation;
+    compaction = std::thread([version, target, target_generation, compacting_path]() {
+        TRACE_SCOPE("World compaction");
+
+        if (write_world_file(*version, target, target_generation))
+            std::remove(compacting_path.c_str());
+    });
+}
+
+void World::WaitForCompaction() {
+    if (compaction.joinable())
+        compaction.join();
+}
+
+void World::AllocateChunks() {
+    state.chunk_count = {(state.size.first + WorldChunk::SIZE - 1) / WorldChunk::SIZE,
+                         (state.size.second + WorldChunk::SIZE - 1) / WorldChunk::SIZE};
+
+    state.chunks.clear();
+    for (int i = 0; i < state.chunk_count.first * state.chunk_count.second; i++) {
+        std::shared_ptr<WorldChunk> chunk = std::make_shared<WorldChunk>();
+        std::fill(chunk->terrain, chunk->terrain + WorldChunk::CELLS, TerrainPalette::DEFAULT_CLASS);
+        std::fill(chunk->component_labels, chunk->component_labels + WorldChunk::CELLS, WorldChunk::NO_COMPONENT);
+        std::fill(chunk->dead_ends, chunk->dead_ends + WorldChunk::CELLS, 0);
+        state.chunks.push_back(chunk);
     }
 
-    file.close();
+    state.components_built = false;
+    state.dead_ends_built = false;
+}
+
+WorldChunk& World::MutableChunk(Position pos) {
+    std::shared_ptr<WorldChunk>& chunk = state.chunks[state.chunk_index(pos)];
+
+    // Only World creates references to its chunks, so a count of one can not go stale
+    if (chunk.use_count() > 1)
+        chunk = std::make_shared<WorldChunk>(*chunk);
+
+    return *chunk;
+}
+
+TerrainPalette& World::MutablePalette() {
+    if (state.palette.use_count() > 1)
+        state.palette = std::make_shared<TerrainPalette>(*state.palette);
+
+    return *state.palette;
+}
+
+std::vector<int>& World::MutableComponents() {
+    if (state.component_parent.use_count() > 1)
+        state.component_parent = std::make_shared<std::vector<int>>(*state.component_parent);
+
+    return *state.component_parent;
+}
+
+int World::ClassFor(float weight) {
+    if (std::isnan(weight))
+        return TerrainPalette::DEFAULT_CLASS;
+
+    int existing = state.palette->find(weight);
+    if (existing != -1)
+        return existing;
+
+    return MutablePalette().ClassFor(weight);
+}
+
+void World::Edited() {
+    // Drop the cached snapshot before touching any chunk so an unshared snapshot does not force a copy
+    published.reset();
+    state.version++;
+}
+
+std::shared_ptr<const WorldSnapshot> World::snapshot() {
+    if (published)
+        return published;
+
+    TRACE_SCOPE("World::snapshot");
+
+    if (!state.components_built)
+        BuildComponents();
+    if (!state.dead_ends_built)
+        BuildDeadEnds();
+
+    // Readers can not compress paths in a const snapshot, so hand them a flat forest. Unless an edit joined
+    // components since the last snapshot it still is, and is shared as it is.
+    if (!components_flat) {
+        for (size_t i = 0; i < state.component_parent->size(); i++)
+            FindComponent(i);
+
+        components_flat = true;
+    }
+
+    published = std::make_shared<const WorldSnapshot>(state);
+
+    return published;
+}
+
+const std::string& World::get_filename() {
+    return filename;
 }
 
 std::pair<int, int> World::get_size() {
-    return size;
+    return state.size;
 }
 
 Position World::get_spawn() {
-    return spawn;
+    return state.spawn;
 }
 
 void World::set_spawn(Position spawn) {
-    if (locked) {
-        std::cerr << "World is locked, can not set spawn" << std::endl;
+    Edited();
 
-        return;
-    }
+    state.spawn = spawn;
 
-    this->spawn = spawn;
+    if (journal)
+        journal->RecordSpawn(spawn);
 }
 
 Position World::get_destination() {
-    return destination;
+    return state.destination;
 }
 
 void World::set_destination(Position destination) {
-    if (locked) {
-        std::cerr << "World is locked, can not set destination" << std::endl;
+    Edited();
 
-        return;
-    }
+    state.destination = destination;
 
-    this->destination = destination;
+    if (journal)
+        journal->RecordDestination(destination);
 }
 
-std::vector<Position> World::get_goals() {
-    return goals;
+const std::vector<Position>& World::get_goals() {
+    return state.goals;
 }
 
 void World::add_goal(Position goal) {
-    if (locked) {
-        std::cerr << "World is locked, can not add goal" << std::endl;
+    Edited();
 
-        return;
-    }
+    state.goals.push_back(goal);
 
-    goals.push_back(goal);
+    if (journal)
+        journal->RecordGoals(state.goals);
 }
 
 void World::remove_goal(Position goal) {
-    if (locked) {
-        std::cerr << "World is locked, can not remove goal" << std::endl;
+    Edited();
 
-        return;
-    }
+    state.goals.erase(std::remove(state.goals.begin(), state.goals.end(), goal), state.goals.end());
 
-    goals.erase(std::remove(goals.begin(), goals.end(), goal), goals.end());
+    if (journal)
+        journal->RecordGoals(state.goals);
 }
 
 void World::set_default_weight(float weight) {
-    if (locked) {
-        std::cerr << "World is locked, can not set default weight" << std::endl;
+    set_terrain_weight(TerrainPalette::DEFAULT_CLASS, weight, weight < IMPASSABLE_WEIGHT);
+}
 
-        return;
+const TerrainPalette& World::get_palette() {
+    return *state.palette;
+}
+
+void World::set_terrain_weight(TerrainClass terrain, float weight, bool passable) {
+    Edited();
+
+    bool was_passable = (*state.palette)[terrain].passable;
+    float old_weight = (*state.palette)[terrain].weight;
+
+    MutablePalette().set_weight(terrain, weight, passable);
+
+    // Journaled by the weight the class had, class numbers are only stable for as long as the world file does not
+    // change. Every cell of the class was written out with that weight, so it finds the same class after a compaction.
+    if (journal)
+        journal->RecordTerrain(terrain == TerrainPalette::DEFAULT_CLASS, old_weight, weight, passable);
+
+    // Could change any number of cells, rebuild on next use
+    if (was_passable != passable) {
+        state.components_built = false;
+        state.dead_ends_built = false;
     }
+}
 
-    default_weight = weight;
+TerrainClass World::get_terrain(Position pos) {
+    return state.get_terrain(pos);
 }
 
-void World::set_weight(Position pos, float weight) {
-    if (locked) {
-        std::cerr << "World is locked, can not set weight" << std::endl;
+void World::set_terrain(Position pos, TerrainClass terrain) {
+    Edited();
 
-        return;
+    bool was_passable = is_passable(pos);
+
+    MutableChunk(pos).terrain[WorldSnapshot::cell_index(pos)] = terrain;
+
+    // Journaled by weight, class numbers are only stable for as long as the world file does not change
+    if (journal)
+        journal->RecordWeight(pos, (*state.palette)[terrain].weight);
+
+    if (state.components_built && was_passable != is_passable(pos)) {
+        if (was_passable)
+            CloseComponentCell(pos);
+        else
+            OpenComponentCell(pos);
     }
 
-    weighted_map[get_position_hashable(pos)] = weight;
+    // Weights do not matter to dead ends, only passability
+    if (state.dead_ends_built && was_passable != is_passable(pos)) {
+        if (was_passable)
+            CloseDeadEndCell(pos);
+        else
+            OpenDeadEndCell(pos);
+    }
+}
+
+bool World::set_weight(Position pos, float weight) {
+    int terrain = ClassFor(weight);
+
+    if (terrain == -1) {
+        std::cerr << "The terrain palette is full, no cell can get the new weight " << weight << std::endl;
+
+        return false;
+    }
+
+    set_terrain(pos, terrain);
+
+    return true;
 }
 
 float World::get_weight(Position pos) {
-    PositionHashable pos_hash = get_position_hashable(pos);
+    return state.get_weight(pos);
+}
+
+bool World::is_passable(Position pos) {
+    return state.is_passable(pos);
+}
+
+bool World::in_bounds(Position pos) {
+    return state.in_bounds(pos);
+}
+
+int World::ComponentLabel(Position pos) {
+    return state.component_label(pos);
+}
+
+void World::SetComponentLabel(Position pos, int label) {
+    WorldChunk& chunk = MutableChunk(pos);
+    uint16_t& cell = chunk.component_labels[WorldSnapshot::cell_index(pos)];
+
+    if (label == -1) {
+        cell = WorldChunk::NO_COMPONENT;
 
-    if (weighted_map.find(pos_hash) != weighted_map.end()) {
-        return weighted_map[pos_hash];
+        return;
+    }
+
+    // Cells are relabeled a group at a time, so the newest labels are the likeliest match
+    for (size_t i = chunk.component_nodes.size(); i-- > 0;) {
+        if (chunk.component_nodes[i] == label) {
+            cell = i;
+
+            return;
+        }
     }
 
-    return default_weight;
+    // Every edit that splits or joins components adds labels, merge them before they run out
+    if (chunk.component_nodes.size() >= WorldChunk::NO_COMPONENT)
+        CompactComponentLabels(chunk);
+
+    chunk.component_nodes.push_back(label);
+    cell = chunk.component_nodes.size() - 1;
 }
 
-PositionHashable World::get_position_hashable(Position pos) {
-    return pos.first * size.second + pos.second;
+void World::CompactComponentLabels(WorldChunk& chunk) {
+    std::vector<int> nodes;
+    std::vector<int> relabel(chunk.component_nodes.size(), -1);
+    std::unordered_map<int, int> root_labels;
+
+    for (int i = 0; i < WorldChunk::CELLS; i++) {
+        uint16_t& label = chunk.component_labels[i];
+        if (label == WorldChunk::NO_COMPONENT)
+            continue;
+
+        if (relabel[label] == -1) {
+            int root = FindComponent(chunk.component_nodes[label]);
+            auto inserted = root_labels.insert({root, (int)nodes.size()});
+            if (inserted.second)
+                nodes.push_back(root);
+
+            relabel[label] = inserted.first->second;
+        }
+
+        label = relabel[label];
+    }
+
+    chunk.component_nodes = nodes;
 }
 
-Position World::get_position(PositionHashable hash) {
-    return {hash / size.second, hash % size.second};
+void World::BuildComponents() {
+    state.component_parent = std::make_shared<std::vector<int>>();
+    std::vector<int>& parent = *state.component_parent;
+
+    // Each chunk is labeled on its own first with a union-find over its cells, each of its components then gets one
+    // node in the world's forest and is joined to the chunks to the left and above
+    std::vector<int> local_parent(WorldChunk::CELLS);
+    auto local_find = [&](int cell) {
+        while (local_parent[cell] != cell)
+            cell = local_parent[cell] = local_parent[local_parent[cell]];
+        return cell;
+    };
+
+    for (int chunk_x = 0; chunk_x < state.chunk_count.first; chunk_x++) {
+        for (int chunk_y = 0; chunk_y < state.chunk_count.second; chunk_y++) {
+            Position origin = {chunk_x * WorldChunk::SIZE, chunk_y * WorldChunk::SIZE};
+            Position end = {std::min(origin.first + WorldChunk::SIZE, state.size.first),
+                            std::min(origin.second + WorldChunk::SIZE, state.size.second)};
+
+            WorldChunk& chunk = MutableChunk(origin);
+            chunk.component_nodes.clear();
+
+            for (int x = origin.first; x < end.first; x++) {
+                for (int y = origin.second; y < end.second; y++) {
+                    int cell = WorldSnapshot::cell_index({x, y});
+                    local_parent[cell] = cell;
+
+                    if (!is_passable({x, y}))
+                        continue;
+
+                    // Cells to the left and above have already been labeled
+                    if (x > origin.first && is_passable({x - 1, y}))
+                        local_parent[local_find(WorldSnapshot::cell_index({x - 1, y}))] = local_find(cell);
+                    if (y > origin.second && is_passable({x, y - 1}))
+                        local_parent[local_find(WorldSnapshot::cell_index({x, y - 1}))] = local_find(cell);
+                }
+            }
+
+            std::fill(chunk.component_labels, chunk.component_labels + WorldChunk::CELLS, WorldChunk::NO_COMPONENT);
+            std::unordered_map<int, uint16_t> root_labels;
+
+            for (int x = origin.first; x < end.first; x++) {
+                for (int y = origin.second; y < end.second; y++) {
+                    if (!is_passable({x, y}))
+                        continue;
+
+                    int root = local_find(WorldSnapshot::cell_index({x, y}));
+                    auto inserted = root_labels.insert({root, (uint16_t)chunk.component_nodes.size()});
+                    if (inserted.second) {
+                        chunk.component_nodes.push_back(parent.size());
+                        parent.push_back(parent.size());
+                    }
+
+                    chunk.component_labels[WorldSnapshot::cell_index({x, y})] = inserted.first->second;
+                }
+            }
+
+            for (int y = origin.second; origin.first > 0 && y < end.second; y++) {
+                if (is_passable({origin.first, y}) && is_passable({origin.first - 1, y}))
+                    UnionComponents(ComponentLabel({origin.first, y}), ComponentLabel({origin.first - 1, y}));
+            }
+            for (int x = origin.first; origin.second > 0 && x < end.first; x++) {
+                if (is_passable({x, origin.second}) && is_passable({x, origin.second - 1}))
+                    UnionComponents(ComponentLabel({x, origin.second}), ComponentLabel({x, origin.second - 1}));
+            }
+        }
+    }
+
+    // Only one node per component is left, so the forest (and every snapshot's copy of it) stays small
+    CollectComponentNodes();
+
+    state.components_built = true;
 }
 
-/*
-World* BIG_OL_WORLD() {
-    // Get Data From Here: https://keesiemeijer.github.io/maze-generator/#generate
-    // With This In Console:
-    //
-    // let out = "";
-    // for (let i = 1; i < mazeNodes.matrix.length; i++) {
-    //     out += "\""
-    //     out += mazeNodes.matrix[i].slice(1);
-    //     out += "\","
-    // }
+int World::NewComponentNode() {
+    // Every edit that opens a cell or splits a component takes a node, without this the forest (and each snapshot's
+    // copy of it) would grow with every edit ever made
+    if (state.component_parent->size() >= component_collect_at)
+        CollectComponentNodes();
 
-    char* data[] = {""};
+    std::vector<int>& parent = MutableComponents();
+    parent.push_back(parent.size());
 
-    std::pair<int, int> size = {400, 250};
+    return parent.size() - 1;
+}
 
-    World* world = new World(size, {0, 0}, {size.first - 1, size.second - 2});
+void World::CollectComponentNodes() {
+    TRACE_SCOPE("World::CollectComponentNodes");
 
-    for (int x = 0; x < size.first; x++) {
-        for (int y = 0; y < size.second; y++) {
-            char c = data[x][y];
-            if (c == '0') {
-                world->set_weight({x, y}, 1.0f);
-            } else {
-                world->set_weight({x, y}, 1221.0f);
+    std::vector<int>& parent = MutableComponents();
+    std::vector<int> dense_ids(parent.size(), -1);
+    int component_count = 0;
+    std::vector<bool> labels_used;
+
+    for (int chunk_x = 0; chunk_x < state.chunk_count.first; chunk_x++) {
+        for (int chunk_y = 0; chunk_y < state.chunk_count.second; chunk_y++) {
+            Position origin = {chunk_x * WorldChunk::SIZE, chunk_y * WorldChunk::SIZE};
+            WorldChunk* chunk = state.chunks[state.chunk_index(origin)].get();
+
+            labels_used.assign(chunk->component_nodes.size(), false);
+            for (int i = 0; i < WorldChunk::CELLS; i++) {
+                if (chunk->component_labels[i] != WorldChunk::NO_COMPONENT)
+                    labels_used[chunk->component_labels[i]] = true;
+            }
+
+            // Labels left behind by relabeled cells or pointing into merged components hold on to nodes
+            bool stale = false;
+            for (size_t label = 0; label < chunk->component_nodes.size(); label++) {
+                int node = chunk->component_nodes[label];
+                stale = stale || !labels_used[label] || parent[node] != node;
+            }
+
+            if (stale) {
+                chunk = &MutableChunk(origin);
+                CompactComponentLabels(*chunk);
+            }
+
+            // Roots are numbered in the order they are met, chunks whose numbers stay the same are not copied and
+            // remain shared with published snapshots
+            bool renumbered = false;
+            for (int node : chunk->component_nodes) {
+                if (dense_ids[node] == -1)
+                    dense_ids[node] = component_count++;
+
+                renumbered = renumbered || dense_ids[node] != node;
+            }
+
+            if (renumbered) {
+                chunk = &MutableChunk(origin);
+                for (int& node : chunk->component_nodes)
+                    node = dense_ids[node];
             }
         }
     }
 
-    return world;
+    parent.resize(component_count);
+    for (int i = 0; i < component_count; i++)
+        parent[i] = i;
+    components_flat = true;
+
+    // Collecting reads every cell, so wait for enough edits to pay for it
+    size_t cells = (size_t)state.size.first * state.size.second;
+    component_collect_at =
+        std::max({2 * parent.size(), cells / CELLS_PER_COMPONENT_COLLECT, MIN_COMPONENT_COLLECT});
+}
+
+int World::FindComponent(int label) {
+    const std::vector<int>& nodes = *state.component_parent;
+
+    int root = label;
+    while (nodes[root] != root)
+        root = nodes[root];
+
+    // A forest shared with a published snapshot is only copied if there is a path to compress
+    if (nodes[label] == root)
+        return root;
+
+    std::vector<int>& parent = MutableComponents();
+    while (parent[label] != root) {
+        int next = parent[label];
+        parent[label] = root;
+        label = next;
+    }
+
+    return root;
+}
+
+void World::UnionComponents(int a, int b) {
+    a = FindComponent(a);
+    b = FindComponent(b);
+
+    if (a != b) {
+        MutableComponents()[std::max(a, b)] = std::min(a, b);
+        components_flat = false;
+    }
+}
+
+void World::OpenComponentCell(Position pos) {
+    int label = NewComponentNode();
+    SetComponentLabel(pos, label);
+
+    Position neighbors[] = {{pos.first + 1, pos.second},
+                            {pos.first - 1, pos.second},
+                            {pos.first, pos.second + 1},
+                            {pos.first, pos.second - 1}};
+
+    for (auto neighbor : neighbors) {
+        if (in_bounds(neighbor) && state.get_component(neighbor) != -1)
+            UnionComponents(label, ComponentLabel(neighbor));
+    }
+}
+
+void World::CloseComponentCell(Position pos) {
+    SetComponentLabel(pos, -1);
+
+    // Closing a cell can split its component, flood out from each neighbor one cell at a time in turn. Floods that
+    // meet are still connected, a flood that runs out before meeting the rest has been cut off and gets a new label.
+    // Each flood stops as soon as the question is settled, so the cost is bounded by the smaller side of any split.
+    struct Flood {
+        std::vector<Position> queue;
+        size_t next = 0;
+        int group;
+    };
+
+    std::vector<Flood> floods;
+    std::unordered_map<PositionHashable, int> visited;
+
+    Position neighbors[] = {{pos.first + 1, pos.second},
+                            {pos.first - 1, pos.second},
+                            {pos.first, pos.second + 1},
+                            {pos.first, pos.second - 1}};
+
+    for (auto neighbor : neighbors) {
+        if (!in_bounds(neighbor) || state.get_component(neighbor) == -1)
+            continue;
+
+        PositionHashable hashable = get_position_hashable(neighbor);
+        if (visited.find(hashable) != visited.end())
+            continue;
+
+        Flood flood;
+        flood.group = floods.size();
+        flood.queue.push_back(neighbor);
+        visited[hashable] = floods.size();
+        floods.push_back(flood);
+    }
+
+    // Groups of floods that have met, tiny union-find over flood indices
+    auto group_of = [&](int flood) {
+        while (floods[flood].group != flood)
+            flood = floods[flood].group;
+        return flood;
+    };
+
+    auto group_active = [&](int group) {
+        for (size_t i = 0; i < floods.size(); i++) {
+            if (group_of(i) == group && floods[i].next < floods[i].queue.size())
+                return true;
+        }
+        return false;
+    };
+
+    auto count_groups = [&]() {
+        int groups = 0;
+        for (size_t i = 0; i < floods.size(); i++) {
+            if (group_of(i) == (int)i)
+                groups++;
+        }
+        return groups;
+    };
+
+    std::vector<bool> settled(floods.size(), false);
+
+    while (count_groups() - std::count(settled.begin(), settled.end(), true) > 1) {
+        for (size_t i = 0; i < floods.size(); i++) {
+            int group = group_of(i);
+            if (settled[group])
+                continue;
+
+            if (!group_active(group)) {
+                // Cut off, everything this group reached becomes a new component
+                int label = NewComponentNode();
+
+                for (size_t j = 0; j < floods.size(); j++) {
+                    if (group_of(j) != group)
+                        continue;
+
+                    for (auto cell : floods[j].queue)
+                        SetComponentLabel(cell, label);
+                }
+
+                settled[group] = true;
+                break;
+            }
+
+            Flood& flood = floods[i];
+            if (flood.next >= flood.queue.size())
+                continue;
+
+            Position cell = flood.queue[flood.next++];
+            Position cell_neighbors[] = {{cell.first + 1, cell.second},
+                                         {cell.first - 1, cell.second},
+                                         {cell.first, cell.second + 1},
+                                         {cell.first, cell.second - 1}};
+
+            for (auto next : cell_neighbors) {
+                if (!in_bounds(next) || state.get_component(next) == -1)
+                    continue;
+
+                PositionHashable hashable = get_position_hashable(next);
+                auto seen = visited.find(hashable);
+
+                if (seen == visited.end()) {
+                    visited[hashable] = i;
+                    flood.queue.push_back(next);
+                } else if (group_of(seen->second) != group_of(i)) {
+                    // Met another flood, merge the groups. Settled groups can never be met, they already claimed
+                    // every cell next to them.
+                    int a = group_of(seen->second);
+                    int b = group_of(i);
+                    floods[std::max(a, b)].group = std::min(a, b);
+                }
+            }
+        }
+    }
+}
+
+uint8_t& World::DeadEndMark(Position pos) {
+    return MutableChunk(pos).dead_ends[WorldSnapshot::cell_index(pos)];
+}
+
+void World::BuildDeadEnds() {
+    TRACE_SCOPE("World::BuildDeadEnds");
+
+    std::vector<Position> pending;
+
+    for (int x = 0; x < state.size.first; x++) {
+        for (int y = 0; y < state.size.second; y++) {
+            if (state.chunks[state.chunk_index({x, y})]->dead_ends[WorldSnapshot::cell_index({x, y})] != 0)
+                DeadEndMark({x, y}) = 0;
+
+            if (is_passable({x, y}))
+                pending.push_back({x, y});
+        }
+    }
+
+    PeelDeadEnds(pending);
+
+    state.dead_ends_built = true;
+}
+
+void World::PeelDeadEnds(std::vector<Position>& pending) {
+    while (!pending.empty()) {
+        Position pos = pending.back();
+        pending.pop_back();
+
+        if (!is_passable(pos) || state.is_dead_end(pos))
+            continue;
+
+        Position neighbors[] = {{pos.first + 1, pos.second},
+                                {pos.first - 1, pos.second},
+                                {pos.first, pos.second + 1},
+                                {pos.first, pos.second - 1}};
+
+        int remaining = 0;
+        int parent = WorldChunk::DEAD_END_ROOT;
+        for (int i = 0; i < 4 && remaining < 2; i++) {
+            if (state.is_core(neighbors[i])) {
+                remaining++;
+                parent = i;
+            }
+        }
+
+        if (remaining > 1)
+            continue;
+
+        // Every other neighbor was peeled first, so the one left is where this cell's tree carries on
+        DeadEndMark(pos) = WorldChunk::DEAD_END | parent;
+
+        if (remaining == 1)
+            pending.push_back(neighbors[parent]);
+    }
+}
+
+void World::HangDeadEnd(Position cell, Position parent) {
+    Position neighbors[] = {{cell.first + 1, cell.second},
+                            {cell.first - 1, cell.second},
+                            {cell.first, cell.second + 1},
+                            {cell.first, cell.second - 1}};
+
+    int direction = WorldChunk::DEAD_END_ROOT;
+    for (int i = 0; i < 4; i++) {
+        if (neighbors[i] == parent)
+            direction = i;
+    }
+
+    DeadEndMark(cell) = WorldChunk::DEAD_END | direction;
+}
+
+void World::OpenDeadEndCell(Position pos) {
+    // Opening a cell only ever adds to the core, and only along the ways out of pos: from each neighbor up its tree
+    // to the top. Two ways that both reach the core, or meet in the same tree, close a loop through pos and join the
+    // core. A tree reached only once hangs off pos instead, its path up to the root turned around. Either way the
+    // cost is the depth of the trees touching pos, not their size.
+    struct Route {
+        Position neighbor;
+        /// @brief From neighbor up to the top of its tree, empty if neighbor is in the core
+        std::vector<Position> path;
+        /// @brief Whether the top hangs off the core, otherwise it is the root of a tree with no core at all
+        bool reaches_core;
+    };
+
+    std::vector<Route> routes;
+    std::unordered_map<PositionHashable, int> root_routes;
+    int core_routes = 0;
+
+    Position neighbors[] = {{pos.first + 1, pos.second},
+                            {pos.first - 1, pos.second},
+                            {pos.first, pos.second + 1},
+                            {pos.first, pos.second - 1}};
+
+    for (auto neighbor : neighbors) {
+        if (!in_bounds(neighbor) || !is_passable(neighbor))
+            continue;
+
+        Route route;
+        route.neighbor = neighbor;
+
+        Position cell = neighbor;
+        while (state.is_dead_end(cell)) {
+            route.path.push_back(cell);
+
+            Position parent = state.get_dead_end_parent(cell);
+            if (parent == cell)
+                break;
+
+            cell = parent;
+        }
+
+        route.reaches_core = route.path.empty() || state.is_core(cell);
+        if (route.reaches_core)
+            core_routes++;
+        else
+            root_routes[get_position_hashable(route.path.back())]++;
+
+        routes.push_back(route);
+    }
+
+    bool loop = core_routes > 1;
+    for (auto& root : root_routes)
+        loop = loop || root.second > 1;
+
+    // Turns the path around from index first on so it leads down to onto
+    auto hang = [&](const std::vector<Position>& path, size_t first, Position onto) {
+        for (size_t i = first; i < path.size(); i++)
+            HangDeadEnd(path[i], i == first ? onto : path[i - 1]);
+    };
+
+    if (!loop) {
+        // pos is a dead end itself, under the one way to the core or else the first tree it touches
+        auto under = std::find_if(routes.begin(), routes.end(), [](const Route& route) { return route.reaches_core; });
+        if (under == routes.end())
+            under = routes.begin();
+
+        if (under == routes.end())
+            HangDeadEnd(pos, pos);
+        else
+            HangDeadEnd(pos, under->neighbor);
+
+        for (auto route = routes.begin(); route != routes.end(); route++) {
+            if (route != under)
+                hang(route->path, 0, pos);
+        }
+
+        return;
+    }
+
+    // pos is in the core now, which its cell mark already says
+    std::unordered_map<PositionHashable, int> crossings;
+    for (auto& route : routes) {
+        if (route.reaches_core) {
+            for (auto cell : route.path)
+                DeadEndMark(cell) = 0;
+        } else if (root_routes[get_position_hashable(route.path.back())] > 1) {
+            for (auto cell : route.path)
+                crossings[get_position_hashable(cell)]++;
+        } else {
+            hang(route.path, 0, pos);
+        }
+    }
+
+    // Within a tree reached more than once, every way up runs into the others at the lowest cell they all cross. The
+    // ways up to there are the loop, above it the tree now hangs off the loop.
+    std::unordered_map<PositionHashable, bool> rerooted;
+    for (auto& route : routes) {
+        if (route.reaches_core)
+            continue;
+
+        PositionHashable root = get_position_hashable(route.path.back());
+        int reached = root_routes[root];
+        if (reached < 2)
+            continue;
+
+        size_t meet = 0;
+        while (crossings[get_position_hashable(route.path[meet])] < reached)
+            meet++;
+
+        for (size_t i = 0; i <= meet; i++)
+            DeadEndMark(route.path[i]) = 0;
+
+        if (!rerooted[root]) {
+            rerooted[root] = true;
+            hang(route.path, meet + 1, route.path[meet]);
+        }
+    }
+}
+
+void World::CloseDeadEndCell(Position pos) {
+    if (state.chunks[state.chunk_index(pos)]->dead_ends[WorldSnapshot::cell_index(pos)] != 0)
+        DeadEndMark(pos) = 0;
+
+    Position neighbors[] = {{pos.first + 1, pos.second},
+                            {pos.first - 1, pos.second},
+                            {pos.first, pos.second + 1},
+                            {pos.first, pos.second - 1}};
+
+    std::vector<Position> pending;
+
+    for (auto neighbor : neighbors) {
+        if (!in_bounds(neighbor) || !is_passable(neighbor))
+            continue;
+
+        // Trees hanging off pos are cut loose, the rest of the map may have lost the loop through pos
+        if (state.is_dead_end(neighbor)) {
+            if (state.get_dead_end_parent(neighbor) == pos)
+                DeadEndMark(neighbor) = WorldChunk::DEAD_END | WorldChunk::DEAD_END_ROOT;
+        } else {
+            pending.push_back(neighbor);
+        }
+    }
+
+    PeelDeadEnds(pending);
+}
+
+int World::get_component(Position pos) {
+    if (!in_bounds(pos))
+        return -1;
+
+    if (!state.components_built)
+        BuildComponents();
+
+    int label = ComponentLabel(pos);
+
+    if (label == -1)
+        return -1;
+
+    return FindComponent(label);
+}
+
+bool World::is_reachable(Position from, Position to) {
+    if (!state.components_built)
+        BuildComponents();
+
+    return state.is_reachable(from, to);
+}
+
+PositionHashable World::get_position_hashable(Position pos) {
+    return state.get_position_hashable(pos);
+}
+
+Position World::get_position(PositionHashable hash) {
+    return state.get_position(hash);
 }
-*/
@@ -1,38 +1,99 @@
 #pragma once
 
-#include <unordered_map>
+#include <memory>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
-typedef std::pair<int, int> Position;
-typedef int PositionHashable;
-
-int distance(Position a, Position b);
+#include "WorldJournal.h"
+#include "WorldSnapshot.h"
 
 class World {
   private:
-    float default_weight = 1;
-    std::pair<int, int> size;
-
-    Position spawn;
-    Position destination;
-    std::vector<Position> goals;
-
-    std::unordered_map<PositionHashable, float> weighted_map;
+    /// @brief The current version, its chunks are copied before being edited if a published snapshot shares them
+    WorldSnapshot state;
+    /// @brief Snapshot of the current version, dropped by every edit
+    std::shared_ptr<const WorldSnapshot> published;
+
+    /// @brief File the world was loaded from, empty if it was built in memory
+    std::string filename;
+    /// @brief Compactions the world file has been through, stored after its weights
+    int generation = 0;
+    /// @brief Edits since filename was last written, only kept for worlds loaded from a file that journal their edits
+    std::unique_ptr<WorldJournal> journal;
+    std::thread compaction;
+
+    void AllocateChunks();
+    /// @brief Copy-on-write access to the chunk holding pos
+    WorldChunk& MutableChunk(Position pos);
+    /// @brief Copy-on-write access to the palette
+    TerrainPalette& MutablePalette();
+    /// @brief Copy-on-write access to the component forest
+    std::vector<int>& MutableComponents();
+    /// @brief Class for weight, only copying the palette if it needs a new class
+    /// @return -1 if weight needs a new class and the palette is full
+    int ClassFor(float weight);
+    void Edited();
+
+    /// @brief Forest size at which unused nodes are collected, at least twice what the last collection left
+    size_t component_collect_at = 0;
+    /// @brief Whether every node points straight at its root, as published snapshots need
+    bool components_flat = true;
+
+    void BuildComponents();
+    /// @return A node that is its own root, collecting unused nodes first if the forest has grown enough
+    int NewComponentNode();
+    /// @brief Relabels every chunk with dense numbers of its components' roots, dropping every other node
+    void CollectComponentNodes();
+    int FindComponent(int label);
+    void UnionComponents(int a, int b);
+    int ComponentLabel(Position pos);
+    /// @param label Union-find node of the cell's component, -1 if it is impassable
+    void SetComponentLabel(Position pos, int label);
+    /// @brief Points each of the chunk's labels at its component's root and merges labels of the same component
+    void CompactComponentLabels(WorldChunk& chunk);
+    void OpenComponentCell(Position pos);
+    void CloseComponentCell(Position pos);
+
+    void BuildDeadEnds();
+    uint8_t& DeadEndMark(Position pos);
+    /// @brief Peels every cell in pending that has at most one passable neighbor left outside dead ends, then every
+    /// cell that leaves with one neighbor fewer, empties pending
+    void PeelDeadEnds(std::vector<Position>& pending);
+    /// @brief Marks cell as a dead end leading back through parent, cell itself for a root
+    void HangDeadEnd(Position cell, Position parent);
+    void OpenDeadEndCell(Position pos);
+    void CloseDeadEndCell(Position pos);
 
   public:
     World(std::pair<int, int> size, Position spawn, Position destination);
 
     ~World();
 
-    World(const char* filename);
+    /// @brief Loads the world file then replays its journal on top
+    /// @param journal_edits Whether later edits are appended to the journal, otherwise they only live in this World
+    /// (though a Compact or save_world still writes them out)
+    World(const char* filename, bool journal_edits = true);
+    /// @brief Writes the current version in one go to a temporary file which then replaces filename, so a crash never
+    /// leaves a partly written world behind
     void save_world(const char* filename);
 
-    /// @brief DO NOT MODIFY UNLESS YOU KNOW WHAT YOUR DOING
-    bool locked = false;
+    /// @brief Writes the current version over the file the world was loaded from on a background thread and empties
+    /// the journal once it is safely on disk. Editing can carry on meanwhile.
+    void Compact();
+    void WaitForCompaction();
+
+    /// @brief An immutable copy of the world as it is now, cheap to take and safe to share between threads. Edits made
+    /// afterwards only copy the chunks they touch.
+    std::shared_ptr<const WorldSnapshot> snapshot();
 
+    /// @brief Weight of cells that were never set
     void set_default_weight(float weight);
 
+    /// @brief File the world was loaded from, empty if it was built in memory
+    const std::string& get_filename();
+
     std::pair<int, int> get_size();
 
     Position get_spawn();
@@ -41,16 +102,28 @@ class World {
     Position get_destination();
     void set_destination(Position destination);
 
-    /// @brief DO NOT MODIFY, GOD WHY CAN'T YOU NOT HAVE MODIFICATION SAFETY LIKE RUST
-    std::vector<Position> get_goals();
+    const std::vector<Position>& get_goals();
     void add_goal(Position goal);
     void remove_goal(Position goal);
 
-    void set_weight(Position pos, float weight);
+    const TerrainPalette& get_palette();
+    /// @brief Rebalances a terrain, every cell of that class changes at once
+    void set_terrain_weight(TerrainClass terrain, float weight, bool passable);
+
+    TerrainClass get_terrain(Position pos);
+    void set_terrain(Position pos, TerrainClass terrain);
+    /// @brief Sets the cell to the terrain class with exactly this weight, adding a class if there is none
+    /// @return false, leaving the cell as it is, if there is no such class and the palette has no room for one
+    bool set_weight(Position pos, float weight);
     float get_weight(Position pos);
+    bool is_passable(Position pos);
+    bool in_bounds(Position pos);
+
+    /// @return Id of the connected component of passable cells containing pos, -1 if pos is impassable
+    int get_component(Position pos);
+    /// @brief Whether a path can walk from one cell to another, from may itself be impassable (like a spawn on a wall)
+    bool is_reachable(Position from, Position to);
 
     PositionHashable get_position_hashable(Position pos);
     Position get_position(PositionHashable hash);
 };
-
-// World* BIG_OL_WORLD();
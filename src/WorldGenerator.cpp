@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "Trace.h"
+#include "WorldGenerator.h"
+
+namespace {
+// splitmix64, used instead of <random> so the output does not depend on the standard library implementation
+uint64_t mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+uint64_t hash_cell(uint64_t seed, uint64_t salt, int x, int y) {
+    return mix(mix(mix(seed ^ salt) ^ (uint64_t)(uint32_t)x) ^ ((uint64_t)(uint32_t)y << 32));
+}
+
+double unit(uint64_t hash) {
+    return (hash >> 11) * (1.0 / 9007199254740992.0);
+}
+
+class Random {
+  private:
+    uint64_t state;
+
+  public:
+    Random(uint64_t seed) : state(mix(seed)) {}
+
+    uint64_t next() {
+        state += 0x9E3779B97F4A7C15ull;
+        return mix(state);
+    }
+
+    /// @return Uniform in [0, bound)
+    uint64_t below(uint64_t bound) {
+        return next() % bound;
+    }
+};
+
+const uint64_t TERRAIN_SALT = 1;
+const uint64_t WALL_SALT = 2;
+const uint64_t BRAID_SALT = 3;
+
+struct GeneratedWorld {
+    int width;
+    int height;
+    /// @brief Index into palette for every cell, stored column major like World
+    std::vector<uint8_t> cells;
+    /// @brief Weights of the terrain mix, the wall weight is last
+    std::vector<float> palette;
+
+    Position spawn;
+    Position destination;
+    std::vector<Position> goals;
+
+    uint8_t wall() {
+        return palette.size() - 1;
+    }
+
+    uint8_t& at(Position pos) {
+        return cells[(size_t)pos.first * height + pos.second];
+    }
+};
+
+class TerrainNoise {
+  private:
+    uint64_t seed;
+    int scale;
+    std::vector<double> thresholds;
+
+    double lattice(int x, int y) {
+        return unit(hash_cell(seed, TERRAIN_SALT, x, y));
+    }
+
+  public:
+    TerrainNoise(WorldGeneratorConfig& config) : seed(config.seed), scale(std::max(1, config.terrain_scale)) {
+        double total = 0;
+        for (auto terrain : config.terrain_mix)
+            total += std::max(0.0f, terrain.second);
+
+        double cumulative = 0;
+        for (auto terrain : config.terrain_mix) {
+            cumulative += std::max(0.0f, terrain.second);
+            thresholds.push_back(total > 0 ? cumulative / total : 1.0);
+        }
+    }
+
+    /// @brief Smoothed value noise, neighbouring cells usually share a terrain
+    uint8_t terrain(int x, int y) {
+        int cell_x = x / scale;
+        int cell_y = y / scale;
+        double t_x = (double)(x % scale) / scale;
+        double t_y = (double)(y % scale) / scale;
+        t_x = t_x * t_x * (3 - 2 * t_x);
+        t_y = t_y * t_y * (3 - 2 * t_y);
+
+        double top = lattice(cell_x, cell_y) * (1 - t_x) + lattice(cell_x + 1, cell_y) * t_x;
+        double bottom = lattice(cell_x, cell_y + 1) * (1 - t_x) + lattice(cell_x + 1, cell_y + 1) * t_x;
+        double value = top * (1 - t_y) + bottom * t_y;
+
+        // Interpolated noise bunches up around 0.5, spread it back out so the shares come out roughly right
+        value = 0.5 + (value - 0.5) * 1.8;
+
+        for (size_t i = 0; i < thresholds.size(); i++) {
+            if (value < thresholds[i])
+                return i;
+        }
+
+        return thresholds.size() - 1;
+    }
+};
+
+void carve_maze(GeneratedWorld& world, WorldGeneratorConfig& config, TerrainNoise& noise, Random& random) {
+    TRACE_SCOPE("WorldGenerator carve maze");
+
+    // Maze nodes sit on even coordinates, the odd cells between them are walls until carved through
+    int nodes_x = (world.width + 1) / 2;
+    int nodes_y = (world.height + 1) / 2;
+
+    std::vector<int> stack = {0};
+    world.at({0, 0}) = noise.terrain(0, 0);
+
+    const int directions[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+    while (!stack.empty()) {
+        int node = stack.back();
+        int node_x = node / nodes_y;
+        int node_y = node % nodes_y;
+
+        int options[4];
+        int option_count = 0;
+        for (int i = 0; i < 4; i++) {
+            int next_x = node_x + directions[i][0];
+            int next_y = node_y + directions[i][1];
+
+            if (next_x < 0 || next_x >= nodes_x || next_y < 0 || next_y >= nodes_y)
+                continue;
+
+            if (world.at({next_x * 2, next_y * 2}) == world.wall())
+                options[option_count++] = i;
+        }
+
+        if (option_count == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        int direction = options[random.below(option_count)];
+        int next_x = node_x + directions[direction][0];
+        int next_y = node_y + directions[direction][1];
+        Position between = {node_x * 2 + directions[direction][0], node_y * 2 + directions[direction][1]};
+
+        world.at(between) = noise.terrain(between.first, between.second);
+        world.at({next_x * 2, next_y * 2}) = noise.terrain(next_x * 2, next_y * 2);
+
+        stack.push_back(next_x * nodes_y + next_y);
+    }
+
+    if (config.maze_braid <= 0)
+        return;
+
+    // Knock out walls that separate two corridors to add loops
+    for (int x = 0; x < world.width; x++) {
+        for (int y = 0; y < world.height; y++) {
+            if ((x + y) % 2 == 0 || world.at({x, y}) != world.wall())
+                continue;
+
+            bool horizontal = x % 2 == 1 && x + 1 < world.width;
+            bool vertical = y % 2 == 1 && y + 1 < world.height;
+            if (!horizontal && !vertical)
+                continue;
+
+            if (unit(hash_cell(config.seed, BRAID_SALT, x, y)) < config.maze_braid)
+                world.at({x, y}) = noise.terrain(x, y);
+        }
+    }
+}
+
+void carve_corridor(GeneratedWorld& world, TerrainNoise& noise, Position from, Position to) {
+    Position pos = from;
+
+    while (true) {
+        if (world.at(pos) == world.wall())
+            world.at(pos) = noise.terrain(pos.first, pos.second);
+
+        if (pos == to)
+            break;
+
+        if (pos.first != to.first)
+            pos.first += pos.first < to.first ? 1 : -1;
+        else
+            pos.second += pos.second < to.second ? 1 : -1;
+    }
+}
+
+bool build(WorldGeneratorConfig& config, GeneratedWorld& world) {
+    TRACE_SCOPE("WorldGenerator build");
+
+    if (config.size.first < 1 || config.size.second < 1 || config.size.first * (int64_t)config.size.second < 2) {
+        std::cerr << "World generator needs at least 2 cells" << std::endl;
+
+        return false;
+    }
+
+    if (config.terrain_mix.empty())
+        config.terrain_mix = {{1.0f, 1.0f}};
+
+    if (config.terrain_mix.size() > 255) {
+        std::cerr << "World generator supports at most 255 terrain types" << std::endl;
+
+        return false;
+    }
+
+    world.width = config.size.first;
+    world.height = config.size.second;
+
+    for (auto terrain : config.terrain_mix)
+        world.palette.push_back(terrain.first);
+    world.palette.push_back(config.wall_weight);
+
+    TerrainNoise noise(config);
+    Random random(config.seed);
+
+    world.cells.assign((size_t)world.width * world.height, world.wall());
+
+    // Maze nodes are on even coordinates, everything else can go anywhere
+    int step = config.maze ? 2 : 1;
+    int slots_x = (world.width + step - 1) / step;
+    int slots_y = (world.height + step - 1) / step;
+
+    world.spawn = {0, 0};
+    world.destination = {(slots_x - 1) * step, (slots_y - 1) * step};
+    if (world.destination == world.spawn)
+        world.destination = world.width > 1 ? Position(1, 0) : Position(0, 1);
+
+    if (config.maze) {
+        carve_maze(world, config, noise, random);
+    } else {
+        for (int x = 0; x < world.width; x++) {
+            for (int y = 0; y < world.height; y++) {
+                if (unit(hash_cell(config.seed, WALL_SALT, x, y)) >= config.wall_density)
+                    world.at({x, y}) = noise.terrain(x, y);
+            }
+        }
+    }
+
+    int64_t slots = (int64_t)slots_x * slots_y;
+    int goal_count = (int)std::max<int64_t>(0, std::min<int64_t>(config.goal_count, slots - 2));
+    while ((int)world.goals.size() < goal_count) {
+        Position goal = {(int)random.below(slots_x) * step, (int)random.below(slots_y) * step};
+
+        if (goal == world.spawn || goal == world.destination ||
+            std::find(world.goals.begin(), world.goals.end(), goal) != world.goals.end())
+            continue;
+
+        world.goals.push_back(goal);
+    }
+
+    // A perfect maze already connects every node, scattered walls need a guaranteed way through
+    if (!config.maze) {
+        for (auto goal : world.goals)
+            carve_corridor(world, noise, world.spawn, goal);
+        carve_corridor(world, noise, world.spawn, world.destination);
+    }
+
+    return true;
+}
+} // namespace
+
+World* WorldGenerator::Generate(WorldGeneratorConfig config) {
+    GeneratedWorld generated;
+    if (!build(config, generated))
+        return nullptr;
+
+    World* world = new World({generated.width, generated.height}, generated.spawn, generated.destination);
+
+    for (auto goal : generated.goals)
+        world->add_goal(goal);
+
+    for (int x = 0; x < generated.width; x++) {
+        for (int y = 0; y < generated.height; y++)
+            world->set_weight({x, y}, generated.palette[generated.at({x, y})]);
+    }
+
+    return world;
+}
+
+bool WorldGenerator::Write(WorldGeneratorConfig config, const char* filename) {
+    GeneratedWorld generated;
+    if (!build(config, generated))
+        return false;
+
+    TRACE_SCOPE("WorldGenerator write");
+
+    std::ofstream file(filename, std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cerr << "Error opening file!" << std::endl;
+
+        return false;
+    }
+
+    std::vector<int> header = {generated.width,
+                               generated.height,
+                               generated.spawn.first,
+                               generated.spawn.second,
+                               generated.destination.first,
+                               generated.destination.second,
+                               (int)generated.goals.size()};
+    for (auto goal : generated.goals) {
+        header.push_back(goal.first);
+        header.push_back(goal.second);
+    }
+    file.write(reinterpret_cast<char*>(header.data()), header.size() * sizeof(int));
+
+    // Same layout as World::save_world, converted a block at a time so the float grid never exists in full
+    const size_t BLOCK_CELLS = 1 << 20;
+    std::vector<float> block;
+    block.reserve(BLOCK_CELLS);
+
+    for (size_t i = 0; i < generated.cells.size(); i++) {
+        block.push_back(generated.palette[generated.cells[i]]);
+
+        if (block.size() == BLOCK_CELLS || i + 1 == generated.cells.size()) {
+            file.write(reinterpret_cast<char*>(block.data()), block.size() * sizeof(float));
+            block.clear();
+        }
+    }
+
+    file.close();
+
+    return !file.fail();
+}
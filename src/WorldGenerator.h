@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "World.h"
+
+struct WorldGeneratorConfig {
+    std::pair<int, int> size = {100, 100};
+    uint64_t seed = 1;
+
+    /// @brief Passable terrain as (weight, share) pairs, shares are relative to each other
+    std::vector<std::pair<float, float>> terrain_mix = {{1.0f, 0.5f}, {2.0f, 0.35f}, {10.0f, 0.15f}};
+    /// @brief Width in cells of the patches terrain is laid out in, 1 gives per-cell noise
+    int terrain_scale = 8;
+
+    /// @brief Chance for any cell to become a wall, ignored for mazes. Walls never cut spawn off from the goals or
+    /// destination
+    float wall_density = 0.1f;
+    float wall_weight = 1221.0f;
+
+    /// @brief Carve a perfect maze (like big_ol_world.dat) instead of scattering walls
+    bool maze = false;
+    /// @brief Fraction of the maze's remaining inner walls to knock out, adding loops
+    float maze_braid = 0.0f;
+
+    int goal_count = 0;
+};
+
+/// @brief Deterministic world generation, the same config always produces the same world on every platform
+namespace WorldGenerator {
+/// @brief Builds the world in memory, only meant for small worlds, use Write for anything large
+World* Generate(WorldGeneratorConfig config);
+/// @brief Streams the world straight to a .dat file in large blocks without building a World, suitable for worlds of
+/// 10k x 10k and up
+bool Write(WorldGeneratorConfig config, const char* filename);
+} // namespace WorldGenerator
@@ -0,0 +1,268 @@
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Trace.h"
+#include "World.h"
+#include "WorldJournal.h"
+
+// Every record is laid out as ints: type, payload length, payload. Floats are stored bit for bit.
+
+static int float_bits(float value) {
+    int bits;
+    memcpy(&bits, &value, sizeof(float));
+    return bits;
+}
+
+static float bits_float(int bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+bool sync_file(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    bool synced = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+        return false;
+
+    bool synced = fsync(file) == 0;
+    close(file);
+#endif
+
+    return synced;
+}
+
+bool replace_file(const std::string& from, const std::string& to) {
+    // Otherwise the rename can reach the disk before the data, leaving an empty or partial file after a power loss
+    if (!sync_file(from))
+        return false;
+
+#ifdef _WIN32
+    // rename refuses to overwrite on Windows, write through makes the move itself durable
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+        return false;
+
+    // The rename is an entry in the directory, which has to be synced on its own
+    size_t slash = to.find_last_of('/');
+    return sync_file(slash == std::string::npos ? "." : slash == 0 ? "/" : to.substr(0, slash));
+#endif
+}
+
+WorldJournal::WorldJournal(const std::string& path) : path(path) {}
+
+std::string WorldJournal::PathFor(const std::string& world_filename) {
+    return world_filename + ".journal";
+}
+
+std::string WorldJournal::CompactingPathFor(const std::string& world_filename) {
+    return world_filename + ".journal.compacting";
+}
+
+void WorldJournal::Append(RecordType type, const std::vector<int>& payload) {
+    if (!file.is_open()) {
+        file.open(path, std::ios::binary | std::ios::app);
+
+        if (!file.is_open()) {
+            std::cerr << "Error opening journal " << path << ", edits will not be saved!" << std::endl;
+
+            return;
+        }
+    }
+
+    std::vector<int> record = {type, (int)payload.size()};
+    record.insert(record.end(), payload.begin(), payload.end());
+
+    // One write per record and flushed straight away, a crash can only ever cut off the last one
+    file.write(reinterpret_cast<const char*>(record.data()), record.size() * sizeof(int));
+    file.flush();
+}
+
+void WorldJournal::RecordWeight(Position pos, float weight) {
+    Append(WEIGHT, {pos.first, pos.second, float_bits(weight)});
+}
+
+void WorldJournal::RecordSpawn(Position spawn) {
+    Append(SPAWN, {spawn.first, spawn.second});
+}
+
+void WorldJournal::RecordDestination(Position destination) {
+    Append(DESTINATION, {destination.first, destination.second});
+}
+
+void WorldJournal::RecordGoals(const std::vector<Position>& goals) {
+    std::vector<int> payload;
+    for (auto goal : goals) {
+        payload.push_back(goal.first);
+        payload.push_back(goal.second);
+    }
+
+    Append(GOALS, payload);
+}
+
+void WorldJournal::RecordTerrain(bool default_class, float old_weight, float weight, bool passable) {
+    Append(TERRAIN, {float_bits(old_weight), float_bits(weight), passable ? 1 : 0, default_class ? 1 : 0});
+}
+
+void WorldJournal::RecordCompaction(int generation) {
+    Append(COMPACTED, {generation});
+}
+
+void WorldJournal::Close() {
+    if (file.is_open())
+        file.close();
+}
+
+int WorldJournal::Replay(const std::string& path, World* world, int generation) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file.is_open())
+        return 0;
+
+    TRACE_SCOPE("WorldJournal::Replay");
+
+    size_t bytes = file.tellg();
+    std::vector<int> data(bytes / sizeof(int));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(int));
+    file.close();
+
+    // Records up to the last compaction the world file has reached are already in it
+    size_t first = 0;
+    for (size_t i = 0; i + 2 <= data.size();) {
+        int length = data[i + 1];
+        if (length < 0 || i + 2 + length > data.size())
+            break;
+
+        if (data[i] == COMPACTED && length == 1 && data[i + 2] <= generation)
+            first = i + 3;
+
+        i += 2 + length;
+    }
+
+    int records = 0;
+    size_t i = first;
+    while (i + 2 <= data.size()) {
+        int type = data[i];
+        int length = data[i + 1];
+
+        // Torn last record
+        if (length < 0 || i + 2 + length > data.size())
+            break;
+
+        const int* payload = data.data() + i + 2;
+
+        if (type == WEIGHT && length == 3) {
+            Position pos = {payload[0], payload[1]};
+            if (world->in_bounds(pos))
+                world->set_weight(pos, bits_float(payload[2]));
+        } else if (type == SPAWN && length == 2) {
+            world->set_spawn({payload[0], payload[1]});
+        } else if (type == DESTINATION && length == 2) {
+            world->set_destination({payload[0], payload[1]});
+        } else if (type == GOALS && length % 2 == 0) {
+            std::vector<Position> goals = world->get_goals();
+            for (auto goal : goals)
+                world->remove_goal(goal);
+            for (int j = 0; j < length; j += 2)
+                world->add_goal({payload[j], payload[j + 1]});
+        } else if (type == TERRAIN && length == 4) {
+            // No class with the old weight means no cell has it either, nothing to rebalance
+            int terrain =
+                payload[3] != 0 ? TerrainPalette::DEFAULT_CLASS : world->get_palette().find(bits_float(payload[0]));
+            if (terrain != -1)
+                world->set_terrain_weight(terrain, bits_float(payload[1]), payload[2] != 0);
+        } else if (type == COMPACTED && length == 1) {
+            // Parked by a compaction that never wrote its world file, the records before it still apply
+        } else if (type == TERRAIN && length == 3) {
+            // Written before records were keyed by weight, the class number is only right if the file never changed
+            if (payload[0] >= 0 && (size_t)payload[0] < world->get_palette().size())
+                world->set_terrain_weight(payload[0], bits_float(payload[1]), payload[2] != 0);
+        } else {
+            std::cerr << "Journal " << path << " is corrupt after " << records << " records, ignoring the rest"
+                      << std::endl;
+
+            break;
+        }
+
+        i += 2 + length;
+        if (type != COMPACTED)
+            records++;
+    }
+
+    // Cut off whatever a crash left after the last whole record, otherwise the next record appended would be read as
+    // part of it
+    if (i * sizeof(int) != bytes) {
+        std::string temp_path = path + ".tmp";
+        std::ofstream temp(temp_path, std::ios::binary | std::ios::trunc);
+        temp.write(reinterpret_cast<const char*>(data.data()), i * sizeof(int));
+        temp.close();
+
+        if (!temp || !replace_file(temp_path, path))
+            std::cerr << "Error repairing journal " << path << std::endl;
+    }
+
+    return records;
+}
+
+bool WorldJournal::MoveRecords(const std::string& from, const std::string& to) {
+    std::ifstream source(from, std::ios::binary);
+
+    // Nothing to move
+    if (!source.is_open())
+        return true;
+
+    std::ifstream existing(to, std::ios::binary);
+    bool to_exists = existing.is_open();
+    existing.close();
+
+    if (!to_exists) {
+        source.close();
+
+        if (std::rename(from.c_str(), to.c_str()) != 0) {
+            std::cerr << "Error moving journal " << from << " to " << to << std::endl;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    std::ofstream destination(to, std::ios::binary | std::ios::app);
+
+    if (!destination.is_open()) {
+        std::cerr << "Error opening journal " << to << std::endl;
+
+        return false;
+    }
+
+    // If this is cut short, from is still whole and is replayed after to, so nothing is lost
+    destination << source.rdbuf();
+    destination.close();
+    source.close();
+
+    if (!destination || std::remove(from.c_str()) != 0) {
+        std::cerr << "Error moving journal " << from << " to " << to << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "WorldSnapshot.h"
+
+class World;
+
+/// @brief Atomically replaces the file at to with the one at from, readers see either the old file or the new one. The
+/// new file is on disk before it replaces the old one and the replacement is on disk before this returns, so even a
+/// power loss leaves one of the two whole.
+bool replace_file(const std::string& from, const std::string& to);
+/// @brief Waits until the file's contents are on disk
+bool sync_file(const std::string& path);
+
+/// @brief Append-only log of the edits made to a world since its file was last written
+///
+/// A record must be applied exactly once: replaying one that already made it into the world file can change it (a
+/// terrain rebalance finds its class by the weight it had, which after a reload may belong to another class).
+/// Compaction parks the records its world file will hold behind a COMPACTED record naming the file's generation, and
+/// replay skips every record up to the last one the world file has reached. That lets compaction replace the world file
+/// and drop the parked records as two separate steps, a crash between them can not lose or double an edit. A record
+/// cut short by a crash is ignored on replay.
+///
+/// Records are handed to the OS as they are written but only synced to disk when compaction parks them, a power loss
+/// can cost the last few edits (never the world file).
+class WorldJournal {
+  public:
+    enum RecordType : int {
+        WEIGHT = 1,
+        SPAWN = 2,
+        DESTINATION = 3,
+        /// @brief The whole goal list, goals are few and this keeps add and remove order independent
+        GOALS = 4,
+        /// @brief A palette entry's weight and passability, the entry named by the weight it had before
+        TERRAIN = 5,
+        /// @brief Every record before it is held by a world file of this generation or later
+        COMPACTED = 6,
+    };
+
+  private:
+    std::string path;
+    /// @brief Opened on the first record so worlds that are never edited do not leave empty journals behind
+    std::ofstream file;
+
+    void Append(RecordType type, const std::vector<int>& payload);
+
+  public:
+    WorldJournal(const std::string& path);
+
+    /// @brief Journal kept next to a world file
+    static std::string PathFor(const std::string& world_filename);
+    /// @brief Where compaction parks the records its snapshot already holds until the world file is replaced
+    static std::string CompactingPathFor(const std::string& world_filename);
+
+    /// @brief Applies every complete record in the file at path to world, a missing file is an empty journal
+    /// @param generation Generation of the world file, records it already holds are skipped
+    /// @return Number of records applied
+    static int Replay(const std::string& path, World* world, int generation);
+    /// @brief Moves every record in from onto the end of to, keeping to's records first
+    static bool MoveRecords(const std::string& from, const std::string& to);
+
+    void RecordWeight(Position pos, float weight);
+    void RecordSpawn(Position spawn);
+    void RecordDestination(Position destination);
+    void RecordGoals(const std::vector<Position>& goals);
+    /// @param default_class Whether the entry is TerrainPalette::DEFAULT_CLASS, every other one is found by old_weight
+    void RecordTerrain(bool default_class, float old_weight, float weight, bool passable);
+    /// @brief Marks every record so far as held by the world file once it reaches generation
+    void RecordCompaction(int generation);
+
+    /// @brief Closes the file, the next record reopens it. Needed before the file is moved.
+    void Close();
+};
@@ -0,0 +1,144 @@
+#include <cstdlib>
+
+#include "WorldSnapshot.h"
+
+int distance(Position a, Position b) {
+    return abs(a.first - b.first) + abs(a.second - b.second);
+}
+
+int WorldSnapshot::chunk_index(Position pos) const {
+    return (pos.first >> WorldChunk::BITS) * chunk_count.second + (pos.second >> WorldChunk::BITS);
+}
+
+int WorldSnapshot::cell_index(Position pos) {
+    return ((pos.first & (WorldChunk::SIZE - 1)) << WorldChunk::BITS) | (pos.second & (WorldChunk::SIZE - 1));
+}
+
+int WorldSnapshot::component_label(Position pos) const {
+    const WorldChunk& chunk = *chunks[chunk_index(pos)];
+    uint16_t label = chunk.component_labels[cell_index(pos)];
+
+    return label == WorldChunk::NO_COMPONENT ? -1 : chunk.component_nodes[label];
+}
+
+std::pair<int, int> WorldSnapshot::get_size() const {
+    return size;
+}
+
+Position WorldSnapshot::get_spawn() const {
+    return spawn;
+}
+
+Position WorldSnapshot::get_destination() const {
+    return destination;
+}
+
+const std::vector<Position>& WorldSnapshot::get_goals() const {
+    return goals;
+}
+
+TerrainClass WorldSnapshot::get_terrain(Position pos) const {
+    return chunks[chunk_index(pos)]->terrain[cell_index(pos)];
+}
+
+const TerrainPalette& WorldSnapshot::get_palette() const {
+    return *palette;
+}
+
+float WorldSnapshot::get_weight(Position pos) const {
+    return (*palette)[get_terrain(pos)].weight;
+}
+
+bool WorldSnapshot::is_passable(Position pos) const {
+    return (*palette)[get_terrain(pos)].passable;
+}
+
+bool WorldSnapshot::in_bounds(Position pos) const {
+    return pos.first >= 0 && pos.first < size.first && pos.second >= 0 && pos.second < size.second;
+}
+
+int WorldSnapshot::get_component(Position pos) const {
+    if (!components_built || !in_bounds(pos))
+        return -1;
+
+    int label = component_label(pos);
+
+    if (label == -1)
+        return -1;
+
+    // Published snapshots are fully compressed so this is a single lookup
+    while ((*component_parent)[label] != label)
+        label = (*component_parent)[label];
+
+    return label;
+}
+
+bool WorldSnapshot::is_reachable(Position from, Position to) const {
+    if (from == to)
+        return true;
+
+    int target = get_component(to);
+
+    if (target == -1)
+        return false;
+
+    if (get_component(from) == target)
+        return true;
+
+    if (!in_bounds(from) || is_passable(from))
+        return false;
+
+    // An impassable start can still step out onto its neighbors
+    Position neighbors[] = {{from.first + 1, from.second},
+                            {from.first - 1, from.second},
+                            {from.first, from.second + 1},
+                            {from.first, from.second - 1}};
+
+    for (auto neighbor : neighbors) {
+        if (get_component(neighbor) == target)
+            return true;
+    }
+
+    return false;
+}
+
+bool WorldSnapshot::is_dead_end(Position pos) const {
+    return chunks[chunk_index(pos)]->dead_ends[cell_index(pos)] & WorldChunk::DEAD_END;
+}
+
+Position WorldSnapshot::get_dead_end_parent(Position pos) const {
+    Position neighbors[] = {{pos.first + 1, pos.second},
+                            {pos.first - 1, pos.second},
+                            {pos.first, pos.second + 1},
+                            {pos.first, pos.second - 1}};
+
+    int parent = chunks[chunk_index(pos)]->dead_ends[cell_index(pos)] & WorldChunk::DEAD_END_PARENT;
+
+    return parent < WorldChunk::DEAD_END_ROOT ? neighbors[parent] : pos;
+}
+
+bool WorldSnapshot::is_core(Position pos) const {
+    return in_bounds(pos) && is_passable(pos) && !is_dead_end(pos);
+}
+
+PositionHashable WorldSnapshot::get_position_hashable(Position pos) const {
+    return pos.first * size.second + pos.second;
+}
+
+Position WorldSnapshot::get_position(PositionHashable hash) const {
+    return {hash / size.second, hash % size.second};
+}
+
+unsigned long WorldSnapshot::get_version() const {
+    return version;
+}
+
+std::shared_ptr<const WorldSnapshot> WorldSnapshot::WithStops(Position spawn, Position destination,
+                                                              const std::vector<Position>& goals) const {
+    auto copy = std::make_shared<WorldSnapshot>(*this);
+    copy->spawn = spawn;
+    copy->destination = destination;
+    copy->goals = goals;
+
+    return copy;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Terrain.h"
+
+typedef std::pair<int, int> Position;
+typedef int PositionHashable;
+
+int distance(Position a, Position b);
+
+/// @brief A square block of cells, the unit World copies when it is edited while snapshots still share it
+struct WorldChunk {
+    static const int BITS = 6;
+    static const int SIZE = 1 << BITS;
+    static const int CELLS = SIZE * SIZE;
+
+    /// @brief TerrainPalette::DEFAULT_CLASS for cells that were never set
+    TerrainClass terrain[CELLS];
+    /// @brief Index into component_nodes of each passable cell, NO_COMPONENT if impassable. A chunk only touches a
+    /// handful of components, so the union-find node is kept once per component instead of once per cell.
+    uint16_t component_labels[CELLS];
+    /// @brief Union-find node of each component label used in the chunk
+    std::vector<int> component_nodes;
+    /// @brief DEAD_END for cells peeled away as dead ends, with the low bits saying which neighbor (+x, -x, +y, -y)
+    /// leads back towards the rest of the map or DEAD_END_ROOT if none does. 0 for every other cell.
+    uint8_t dead_ends[CELLS];
+
+    static const uint16_t NO_COMPONENT = 0xFFFF;
+
+    static const uint8_t DEAD_END = 0x80;
+    static const uint8_t DEAD_END_ROOT = 4;
+    static const uint8_t DEAD_END_PARENT = 0x7;
+};
+
+/// @brief An immutable version of a World
+///
+/// Taken with World::snapshot() and shared through std::shared_ptr<const WorldSnapshot>, every accessor is const and
+/// nothing is cached lazily, so any number of threads can read one snapshot at once. Snapshots of consecutive versions
+/// share every chunk that was not edited in between.
+class WorldSnapshot {
+    friend class World;
+
+  private:
+    std::pair<int, int> size;
+    /// @brief Shared between versions until it is edited, like the chunks
+    std::shared_ptr<TerrainPalette> palette = std::make_shared<TerrainPalette>();
+
+    Position spawn;
+    Position destination;
+    std::vector<Position> goals;
+
+    std::pair<int, int> chunk_count;
+    std::vector<std::shared_ptr<WorldChunk>> chunks;
+
+    /// @brief Whether every chunk's dead_ends are up to date, always true in published snapshots
+    bool dead_ends_built = false;
+
+    /// @brief Only valid when components_built, fully path compressed in published snapshots
+    bool components_built = false;
+    /// @brief Shared between versions until an edit joins or splits components, like the palette
+    std::shared_ptr<std::vector<int>> component_parent = std::make_shared<std::vector<int>>();
+
+    unsigned long version = 0;
+
+    int chunk_index(Position pos) const;
+    static int cell_index(Position pos);
+    /// @return Union-find node the cell is labeled with, -1 if it is impassable
+    int component_label(Position pos) const;
+
+  public:
+    std::pair<int, int> get_size() const;
+    Position get_spawn() const;
+    Position get_destination() const;
+    const std::vector<Position>& get_goals() const;
+
+    TerrainClass get_terrain(Position pos) const;
+    const TerrainPalette& get_palette() const;
+    /// @brief Weight of the cell's terrain
+    float get_weight(Position pos) const;
+    bool is_passable(Position pos) const;
+    bool in_bounds(Position pos) const;
+
+    /// @return Id of the connected component of passable cells containing pos, -1 if pos is impassable
+    int get_component(Position pos) const;
+    /// @brief Whether a path can walk from one cell to another, from may itself be impassable (like a spawn on a wall)
+    bool is_reachable(Position from, Position to) const;
+
+    /// @brief Whether a passable cell is in a dead end, what is left after repeatedly peeling away every passable
+    /// cell with at most one passable neighbor. A path only ever enters a dead end to reach a cell inside it, so they
+    /// form trees hanging off the rest of the map (or whole components that are trees).
+    bool is_dead_end(Position pos) const;
+    /// @return The next cell of a dead end's tree towards the rest of the map, pos itself at the top of a tree that
+    /// makes up its whole component
+    Position get_dead_end_parent(Position pos) const;
+    /// @brief Passable and not in a dead end
+    bool is_core(Position pos) const;
+
+    PositionHashable get_position_hashable(Position pos) const;
+    Position get_position(PositionHashable hash) const;
+
+    /// @brief Increases with every edit made to the World this was taken from
+    unsigned long get_version() const;
+
+    /// @brief The same terrain with another spawn, destination and goals, for searching between arbitrary cells. Shares
+    /// every chunk, the palette and the component forest.
+    std::shared_ptr<const WorldSnapshot> WithStops(Position spawn, Position destination,
+                                                   const std::vector<Position>& goals) const;
+};
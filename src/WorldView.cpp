@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Trace.h"
+#include "WorldView.h"
+
+WorldView::WorldView(Rectangle viewport) : viewport(viewport) {
+    camera.offset = {viewport.x + viewport.width / 2, viewport.y + viewport.height / 2};
+    camera.target = {0, 0};
+    camera.rotation = 0;
+    camera.zoom = 1;
+}
+
+WorldView::~WorldView() {
+    Unload();
+}
+
+void WorldView::Unload() {
+    for (auto texture : lod_levels)
+        UnloadTexture(texture);
+
+    lod_levels.clear();
+}
+
+void WorldView::Load(const WorldSnapshot& world) {
+    TRACE_SCOPE("WorldView::Load");
+
+    Unload();
+
+    world_size = world.get_size();
+
+    // The finest level that fits, every cell is read once to build it
+    lod_base = 0;
+    while (((world_size.first - 1) >> lod_base) + 1 > MAX_LOD_TEXTURE_SIZE ||
+           ((world_size.second - 1) >> lod_base) + 1 > MAX_LOD_TEXTURE_SIZE)
+        lod_base++;
+
+    int width = ((world_size.first - 1) >> lod_base) + 1;
+    int height = ((world_size.second - 1) >> lod_base) + 1;
+
+    std::vector<unsigned int> sums((size_t)width * height * 4, 0);
+    std::vector<unsigned int> counts((size_t)width * height, 0);
+
+    const TerrainPalette& palette = world.get_palette();
+
+    for (int x = 0; x < world_size.first; x++) {
+        for (int y = 0; y < world_size.second; y++) {
+            const uint8_t* rgba = palette[world.get_terrain({x, y})].color;
+            Color color = {rgba[0], rgba[1], rgba[2], rgba[3]};
+            size_t texel = (size_t)(y >> lod_base) * width + (x >> lod_base);
+
+            sums[texel * 4] += color.r;
+            sums[texel * 4 + 1] += color.g;
+            sums[texel * 4 + 2] += color.b;
+            sums[texel * 4 + 3] += color.a;
+            counts[texel]++;
+        }
+    }
+
+    std::vector<Color> pixels(width * height);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = {(unsigned char)(sums[i * 4] / counts[i]), (unsigned char)(sums[i * 4 + 1] / counts[i]),
+                     (unsigned char)(sums[i * 4 + 2] / counts[i]), (unsigned char)(sums[i * 4 + 3] / counts[i])};
+    }
+
+    while (true) {
+        Image image = {pixels.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        Texture2D texture = LoadTextureFromImage(image);
+        SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+        lod_levels.push_back(texture);
+
+        if (width <= 1 && height <= 1)
+            break;
+
+        // Halve by averaging 2x2 blocks, odd edges average what they have
+        int next_width = (width + 1) / 2;
+        int next_height = (height + 1) / 2;
+        std::vector<Color> next(next_width * next_height);
+
+        for (int y = 0; y < next_height; y++) {
+            for (int x = 0; x < next_width; x++) {
+                int sum[4] = {0, 0, 0, 0};
+                int count = 0;
+
+                for (int dy = 0; dy < 2; dy++) {
+                    for (int dx = 0; dx < 2; dx++) {
+                        int sx = x * 2 + dx;
+                        int sy = y * 2 + dy;
+                        if (sx >= width || sy >= height)
+                            continue;
+
+                        Color color = pixels[sy * width + sx];
+                        sum[0] += color.r;
+                        sum[1] += color.g;
+                        sum[2] += color.b;
+                        sum[3] += color.a;
+                        count++;
+                    }
+                }
+
+                next[y * next_width + x] = {(unsigned char)(sum[0] / count), (unsigned char)(sum[1] / count),
+                                            (unsigned char)(sum[2] / count), (unsigned char)(sum[3] / count)};
+            }
+        }
+
+        pixels.swap(next);
+        width = next_width;
+        height = next_height;
+    }
+
+    Fit();
+}
+
+void WorldView::Fit() {
+    camera.offset = {viewport.x + viewport.width / 2, viewport.y + viewport.height / 2};
+    camera.target = {world_size.first * TILE_SIZE / 2.0f, world_size.second * TILE_SIZE / 2.0f};
+
+    // Never blow tiles up past their texture size when fitting
+    camera.zoom = std::min(1.0f, std::min(viewport.width / (world_size.first * TILE_SIZE),
+                                          viewport.height / (world_size.second * TILE_SIZE)));
+}
+
+void WorldView::ClampCamera() {
+    float fit_zoom = std::min(viewport.width / (world_size.first * TILE_SIZE),
+                              viewport.height / (world_size.second * TILE_SIZE));
+    camera.zoom = std::max(std::min(fit_zoom, 1.0f) / 2, std::min(camera.zoom, 4.0f));
+
+    camera.target.x = std::max(0.0f, std::min(camera.target.x, (float)world_size.first * TILE_SIZE));
+    camera.target.y = std::max(0.0f, std::min(camera.target.y, (float)world_size.second * TILE_SIZE));
+}
+
+void WorldView::Update() {
+    Vector2 mouse = GetMousePosition();
+
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0 && CheckCollisionPointRec(mouse, viewport)) {
+        // Keep the point under the cursor where it is
+        camera.target = GetScreenToWorld2D(mouse, camera);
+        camera.offset = mouse;
+        camera.zoom *= std::pow(1.25f, wheel);
+    }
+
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || IsMouseButtonDown(MOUSE_BUTTON_MIDDLE)) {
+        Vector2 delta = GetMouseDelta();
+        camera.target.x -= delta.x / camera.zoom;
+        camera.target.y -= delta.y / camera.zoom;
+    }
+
+    if (IsKeyPressed(KEY_F))
+        Fit();
+
+    ClampCamera();
+}
+
+void WorldView::Begin() {
+    BeginScissorMode(viewport.x, viewport.y, viewport.width, viewport.height);
+    BeginMode2D(camera);
+}
+
+void WorldView::End() {
+    EndMode2D();
+    EndScissorMode();
+}
+
+float WorldView::pixels_per_tile() {
+    return camera.zoom * TILE_SIZE;
+}
+
+bool WorldView::zoomed_out() {
+    return pixels_per_tile() < LOD_PIXELS_PER_TILE;
+}
+
+float WorldView::min_marker_size() {
+    return std::max((float)TILE_SIZE, 4 / camera.zoom);
+}
+
+void WorldView::visible_tiles(Position& min, Position& max) {
+    Vector2 top_left = GetScreenToWorld2D({viewport.x, viewport.y}, camera);
+    Vector2 bottom_right = GetScreenToWorld2D({viewport.x + viewport.width, viewport.y + viewport.height}, camera);
+
+    min.first = std::max(0, std::min(world_size.first, (int)std::floor(top_left.x / TILE_SIZE)));
+    min.second = std::max(0, std::min(world_size.second, (int)std::floor(top_left.y / TILE_SIZE)));
+    max.first = std::max(0, std::min(world_size.first, (int)std::floor(bottom_right.x / TILE_SIZE) + 1));
+    max.second = std::max(0, std::min(world_size.second, (int)std::floor(bottom_right.y / TILE_SIZE) + 1));
+}
+
+void WorldView::DrawOverview() {
+    if (lod_levels.empty())
+        return;
+
+    size_t level = 0;
+    while (level + 1 < lod_levels.size() && (1 << (lod_base + level)) * pixels_per_tile() < 1)
+        level++;
+
+    float tiles_per_texel = 1 << (lod_base + level);
+
+    Position min, max;
+    visible_tiles(min, max);
+
+    Rectangle source = {min.first / tiles_per_texel, min.second / tiles_per_texel,
+                        (max.first - min.first) / tiles_per_texel, (max.second - min.second) / tiles_per_texel};
+    Rectangle destination = {(float)min.first * TILE_SIZE, (float)min.second * TILE_SIZE,
+                             (float)(max.first - min.first) * TILE_SIZE, (float)(max.second - min.second) * TILE_SIZE};
+
+    DrawTexturePro(lod_levels[level], source, destination, {0, 0}, 0, WHITE);
+}
+
+Vector2 WorldView::tile_center(Position pos) {
+    return {pos.first * TILE_SIZE + TILE_SIZE / 2.0f, pos.second * TILE_SIZE + TILE_SIZE / 2.0f};
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "WorldSnapshot.h"
+#include "raylib.h"
+
+/// @brief Pan and zoom camera over a world drawn into part of the screen
+///
+/// The world is laid out TILE_SIZE units per tile and looked at through a Camera2D. Callers only draw the tiles in
+/// visible_tiles(), and once tiles shrink below LOD_PIXELS_PER_TILE they draw the overview instead: a pyramid of
+/// textures with one texel per 1, 2, 4, ... tiles, of which only the visible part of the finest level whose texels
+/// still cover a screen pixel is drawn. Either way the work per frame is bounded by the viewport, not the world.
+class WorldView {
+  public:
+    /// @brief World units per tile, matches the larger tile textures
+    static const int TILE_SIZE = 32;
+    /// @brief Below this many screen pixels per tile individual tiles are not drawn
+    static constexpr float LOD_PIXELS_PER_TILE = 8.0f;
+    /// @brief Overview levels larger than this on either side are skipped to bound texture memory
+    static const int MAX_LOD_TEXTURE_SIZE = 4096;
+
+  private:
+    Rectangle viewport;
+    Camera2D camera;
+    std::pair<int, int> world_size = {0, 0};
+
+    /// @brief lod_levels[i] has one texel per (1 << (lod_base + i)) tiles on each side
+    std::vector<Texture2D> lod_levels;
+    int lod_base = 0;
+
+    void ClampCamera();
+
+  public:
+    WorldView(Rectangle viewport);
+    ~WorldView();
+
+    /// @brief Switches to a world, rebuilding the overview and fitting the whole world into the viewport. Overview
+    /// texels take the palette colors of the cells they cover.
+    void Load(const WorldSnapshot& world);
+    /// @brief Frees the overview textures, must happen before the window is closed
+    void Unload();
+    /// @brief Fits the whole world into the viewport
+    void Fit();
+
+    /// @brief Zooms with the mouse wheel around the cursor, pans with a right or middle mouse drag, F refits
+    void Update();
+
+    /// @brief Starts drawing in world units, clipped to the viewport
+    void Begin();
+    void End();
+
+    float pixels_per_tile();
+    /// @brief Whether tiles are too small to draw one by one and DrawOverview should be used instead
+    bool zoomed_out();
+    /// @brief Smallest size in world units that still shows up as a few pixels on screen, for markers
+    float min_marker_size();
+
+    /// @brief Tiles at least partly inside the viewport, from min up to but excluding max
+    void visible_tiles(Position& min, Position& max);
+    /// @brief Draws the visible part of the overview, must be between Begin and End
+    void DrawOverview();
+
+    Vector2 tile_center(Position pos);
+};
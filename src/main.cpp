@@ -1,6 +1,17 @@
+#include "ContractionHierarchy.h"
+#include "DeltaSteppingPathFinder.h"
+#include "Headless.h"
+#include "HierarchyPathFinder.h"
 #include "Pathfinder.h"
+#include "QueryService.h"
+#include "SearchTrace.h"
+#include "TileAtlas.h"
+#include "Trace.h"
 #include "World.h"
+#include "WorldView.h"
 #include "raylib.h"
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #ifndef ASSETS_PATH
@@ -10,46 +21,43 @@
 const int LINE_SEPERATION = 3;
 const Color PATHFINDER_COLOR = ORANGE;
 const Color PATHFINDER_MINI_COLOR = Fade(ORANGE, 0.5f);
+const Color BEST_PATH_COLOR = SKYBLUE;
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+        return RunHeadless(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+        return RunService(argc, argv);
+
+    const char* playbackFile = nullptr;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0)
+            Trace::BeginSession(argv[++i]);
+        else if (strcmp(argv[i], "--playback") == 0)
+            playbackFile = argv[++i];
+    }
 
-int main() {
     // Initialize Raylib
     InitWindow(1600, 900, "The Legend of Alberta");
     SetTargetFPS(60);
 
-    // Initialize textures
-    Texture2D path16Texture = LoadTexture(ASSETS_PATH "tiles/16/sand.png");
-    Texture2D path32Texture = LoadTexture(ASSETS_PATH "tiles/32/sand.png");
-    Texture2D bridge16Texture = LoadTexture(ASSETS_PATH "tiles/16/bridge.png");
-    Texture2D bridge32Texture = LoadTexture(ASSETS_PATH "tiles/32/bridge.png");
-    Texture2D grass16Texture = LoadTexture(ASSETS_PATH "tiles/16/grass.png");
-    Texture2D grass32Texture = LoadTexture(ASSETS_PATH "tiles/32/grass.png");
-    Texture2D river16Texture = LoadTexture(ASSETS_PATH "tiles/16/river.png");
-    Texture2D river32Texture = LoadTexture(ASSETS_PATH "tiles/32/river.png");
-    Texture2D tree16Texture = LoadTexture(ASSETS_PATH "tiles/16/tree.png");
-    Texture2D tree32Texture = LoadTexture(ASSETS_PATH "tiles/32/tree.png");
-    Texture2D coin16Texture = LoadTexture(ASSETS_PATH "tiles/16/coin.png");
-    Texture2D coin32Texture = LoadTexture(ASSETS_PATH "tiles/32/coin.png");
-    Texture2D black16Texture = LoadTexture(ASSETS_PATH "tiles/16/black.png");
-    Texture2D black32Texture = LoadTexture(ASSETS_PATH "tiles/32/black.png");
-    Texture2D flame16Texture = LoadTexture(ASSETS_PATH "tiles/16/flame.png");
-    Texture2D flame32Texture = LoadTexture(ASSETS_PATH "tiles/32/flame.png");
-    Texture2D sword16Texture = LoadTexture(ASSETS_PATH "tiles/16/sword.png");
-    Texture2D sword32Texture = LoadTexture(ASSETS_PATH "tiles/32/sword.png");
-    Texture2D zRock16Texture = LoadTexture(ASSETS_PATH "tiles/16/Z_rock.png");
-    Texture2D zRock32Texture = LoadTexture(ASSETS_PATH "tiles/32/Z_rock.png");
-    Texture2D gem16Texture = LoadTexture(ASSETS_PATH "tiles/16/gem.png");
-    Texture2D gem32Texture = LoadTexture(ASSETS_PATH "tiles/32/gem.png");
-    Texture2D oldMan16Texture = LoadTexture(ASSETS_PATH "tiles/16/oldman.png");
-    Texture2D oldMan32Texture = LoadTexture(ASSETS_PATH "tiles/32/oldman.png");
-    Texture2D alberta16Texture = LoadTexture(ASSETS_PATH "tiles/16/alberta.png");
-    Texture2D alberta32Texture = LoadTexture(ASSETS_PATH "tiles/32/alberta.png");
+    // Every tile texture is packed into one, so all tiles draw in a single batch
+    TileAtlas tileAtlas;
+    tileAtlas.Load(ASSETS_PATH "tiles/");
 
     // Dropdown and GUI state variables
-    const char* algorithms[] = {"A*", "Dijkstra", "Dijkstra's Crow", "Dijkstra's Folly"};
+    const char* algorithms[] = {"A*", "Dijkstra", "Dijkstra's Crow", "Dijkstra's Folly", "Weighted A* (e = 2)",
+                                "Anytime A*", "Contraction Hierarchy", "Delta-Stepping (Parallel)"};
     PathfinderHeuristicFn algorithmFns[] = {AStar::Heuristic, Dijkstra::Heuristic, DijkstraCrow::Heuristic,
-                                            DijkstraFolly::Heuristic};
+                                            DijkstraFolly::Heuristic, AStar::Heuristic, AStar::Heuristic,
+                                            Dijkstra::Heuristic, Dijkstra::Heuristic};
+    SearchOptions algorithmOptions[] = {{}, {}, {}, {}, {SearchMode::Weighted, 2.0f},
+                                        {SearchMode::Anytime, 3.0f, 0.5f}, {}, {}};
     const int algorithmCount = sizeof(algorithms) / sizeof(*algorithms);
-    int selectedAlgorithm = 0; // 0 = A*, 1 = Dijkstra, 2 = Dijkstra's Crow, 3 = Dijkstra's Folly
+    const int hierarchyAlgorithm = 6;
+    const int deltaSteppingAlgorithm = 7;
+    int selectedAlgorithm = 0; // 0 = A*, 1 = Dijkstra, 2 = Dijkstra's Crow, 3 = Dijkstra's Folly, 4 = Weighted,
+                               // 5 = Anytime, 6 = Contraction Hierarchy, 7 = Delta-Stepping
     const char* maps[] = {"Bridge", "Paths", "Florida", "Big Boy", "It's Dangerous To Go Alone!"};
     const char* mapFiles[] = {ASSETS_PATH "worlds/bridge.dat", ASSETS_PATH "worlds/paths.dat",
                               ASSETS_PATH "worlds/florida.dat", ASSETS_PATH "worlds/big_ol_world.dat",
@@ -70,15 +78,69 @@ int main() {
     Rectangle restartButton = {1400, 860, 150, 30};
 
     bool runningPathfinder = false;
+    bool showStats = false;
     int currentFrame = 0;
 
-    // Create World and PathFinder objects
-    World* world = new World(mapFiles[selectedMap]);
-    PathFinder* pathfinder = new PathFinder(world, algorithmFns[selectedAlgorithm]);
+    // Create World and PathFinder objects, every PathFinder reuses the same search storage
+    SearchContext searchContext;
+
+    // A recorded search (from --headless --record) replaces the live one until another map or algorithm is picked
+    SearchTracePlayer* player = nullptr;
+    if (playbackFile != nullptr) {
+        player = new SearchTracePlayer();
+        if (!player->Load(playbackFile)) {
+            delete player;
+            player = nullptr;
+        }
+    }
+
+    World* world = new World(player != nullptr ? player->get_map().c_str() : mapFiles[selectedMap]);
+    if (player != nullptr && world->get_size() != player->get_size()) {
+        std::cout << "Recorded search does not match its map " << player->get_map() << std::endl;
+
+        delete player;
+        player = nullptr;
+        delete world;
+        world = new World(mapFiles[selectedMap]);
+    }
+
+    // Loaded from (or built and saved to) a sidecar next to the map the first time it is picked on that map
+    ContractionHierarchy* hierarchy = nullptr;
+    auto makePathfinder = [&]() -> PathFinder* {
+        if (selectedAlgorithm == deltaSteppingAlgorithm)
+            return new DeltaSteppingPathFinder(world, &searchContext);
+
+        if (selectedAlgorithm != hierarchyAlgorithm)
+            return new PathFinder(world, algorithmFns[selectedAlgorithm], &searchContext,
+                                  algorithmOptions[selectedAlgorithm]);
+
+        if (hierarchy == nullptr)
+            hierarchy = ContractionHierarchy::LoadOrBuild(world->get_filename().c_str(), *world->snapshot());
+
+        return new HierarchyPathFinder(world, hierarchy, &searchContext);
+    };
+
+    PathFinder* pathfinder = makePathfinder();
+
+    // The map area above the controls
+    WorldView view({0, 0, 1600, 750});
+    Rectangle scrubRect = {10, 730, 1580, 12};
+    view.Load(*world->snapshot());
 
     while (!WindowShouldClose()) {
+        TRACE_SCOPE("Frame");
+
         // Run Pathfinder Step
-        if (runningPathfinder) {
+        if (runningPathfinder && player != nullptr) {
+            if (player->get_step() < player->step_count()) {
+                if (currentFrame % (stallFrames[selectedSpeed] + 1) == 0)
+                    player->Seek(player->get_step() + (selectedSpeed == 4 ? 10 : 1));
+            } else {
+                runningPathfinder = false;
+            }
+        } else if (runningPathfinder) {
+            TRACE_SCOPE("Pathfinder steps");
+
             if (!pathfinder->completed() && !pathfinder->failed()) {
                 if (currentFrame % (stallFrames[selectedSpeed] + 1) == 0) {
                     pathfinder->Step();
@@ -98,6 +160,26 @@ int main() {
 
         Vector2 mousePos = GetMousePosition();
 
+        if (IsKeyPressed(KEY_I))
+            showStats = !showStats;
+
+        // Scrub through a recorded search
+        if (player != nullptr) {
+            if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mousePos, scrubRect)) {
+                runningPathfinder = false;
+                player->Seek((mousePos.x - scrubRect.x) / scrubRect.width * player->step_count());
+            }
+
+            if (IsKeyPressed(KEY_RIGHT))
+                player->Seek(player->get_step() + 1);
+            if (IsKeyPressed(KEY_LEFT) && player->get_step() > 0)
+                player->Seek(player->get_step() - 1);
+            if (IsKeyPressed(KEY_HOME))
+                player->Seek(0);
+            if (IsKeyPressed(KEY_END))
+                player->Seek(player->step_count());
+        }
+
         // Handle dropdown interaction
         if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
             if (CheckCollisionPointRec(mousePos, dropdownRect)) {
@@ -106,8 +188,11 @@ int main() {
                 selectedAlgorithm = ++selectedAlgorithm % algorithmCount; // Choose algorithm
                 std::cout << selectedAlgorithm << std::endl;
 
+                delete player;
+                player = nullptr;
+
                 delete pathfinder;
-                pathfinder = new PathFinder(world, algorithmFns[selectedAlgorithm]);
+                pathfinder = makePathfinder();
             }
 
             if (CheckCollisionPointRec(mousePos, mapRect)) {
@@ -116,10 +201,16 @@ int main() {
                 selectedMap = ++selectedMap % mapCount; // Choose map
                 std::cout << selectedMap << std::endl;
 
+                delete player;
+                player = nullptr;
+
                 delete pathfinder;
+                delete hierarchy;
+                hierarchy = nullptr;
                 delete world;
                 world = new World(mapFiles[selectedMap]);
-                pathfinder = new PathFinder(world, algorithmFns[selectedAlgorithm]);
+                pathfinder = makePathfinder();
+                view.Load(*world->snapshot());
             }
 
             if (CheckCollisionPointRec(mousePos, speedRect)) {
@@ -135,7 +226,10 @@ int main() {
             // Handle step button
             if (CheckCollisionPointRec(mousePos, stepButton)) {
                 // Step pathfinder
-                if (!runningPathfinder) {
+                if (player != nullptr) {
+                    runningPathfinder = false;
+                    player->Seek(player->get_step() + 1);
+                } else if (!runningPathfinder) {
                     pathfinder->Step();
                 } else {
                     runningPathfinder = false;
@@ -150,154 +244,129 @@ int main() {
             if (CheckCollisionPointRec(mousePos, restartButton)) {
                 runningPathfinder = false;
 
+                if (player != nullptr)
+                    player->Seek(0);
+
                 delete pathfinder;
-                pathfinder = new PathFinder(world, algorithmFns[selectedAlgorithm]);
+                pathfinder = makePathfinder();
             }
         }
 
-        // Calculate map size
-        int tileSize = 32;
-        int mapWidth = world->get_size().first * tileSize;
-        int mapHeight = world->get_size().second * tileSize;
-        if (mapWidth >= 1600 || mapHeight >= 750) {
-            tileSize = 16;
-            mapWidth = world->get_size().first * tileSize;
-            mapHeight = world->get_size().second * tileSize;
-
-            if (mapWidth >= 1600 || mapHeight >= 750) {
-                tileSize = std::min(1600 / world->get_size().first, 750 / world->get_size().second);
-                mapWidth = world->get_size().first * tileSize;
-                mapHeight = world->get_size().second * tileSize;
-            }
-        }
-        int mapOffsetX = (1600 - mapWidth) / 2;
-        int mapOffsetY = (750 - mapHeight) / 2;
+        view.Update();
 
         /****    RENDERING    ****/
 
+        TRACE_SCOPE("Render");
+
         BeginDrawing();
         ClearBackground(BLACK);
 
-        // Draw tiles
-        for (int y = 0; y < world->get_size().second; ++y) {
-            for (int x = 0; x < world->get_size().first; ++x) {
-                Position pos = {x, y};
-                float weight = world->get_weight(pos);
-                Color tileColor;
-                Texture2D tileTexture;
-
-                // Select tile color based on weight
-                if (weight == 1.0f) { // Path
-                    tileColor = DARKGRAY;
-                    tileTexture = tileSize == 16 ? path16Texture : path32Texture;
-                } else if (weight == 1.0078125f) { // Zelda Black
-                    tileColor = BLACK;
-                    tileTexture = tileSize == 16 ? black16Texture : black32Texture;
-                } else if (weight == 1.5f) { // Bridge
-                    tileColor = BEIGE;
-                    tileTexture = tileSize == 16 ? bridge16Texture : bridge32Texture;
-                } else if (weight == 2.0f) { // Grass
-                    tileColor = GREEN;
-                    tileTexture = tileSize == 16 ? grass16Texture : grass32Texture;
-                } else if (weight == 10.0f) { // River
-                    tileColor = BLUE;
-                    tileTexture = tileSize == 16 ? river16Texture : river32Texture;
-                } else if (weight == 1001.0f) { // Tree
-                    tileColor = BROWN;
-                    tileTexture = tileSize == 16 ? tree16Texture : tree32Texture;
-                } else if (weight == 1200.0f) { // Zelda Rock
-                    tileColor = BLACK;
-                    tileTexture = tileSize == 16 ? zRock16Texture : zRock32Texture;
-                } else if (weight == 1221.0f) { // Black Wall
-                    tileColor = BLACK;
-                    tileTexture = tileSize == 16 ? black16Texture : black32Texture;
-                } else if (weight == 1532.0f) { // Zelda Flame
-                    tileColor = BLACK;
-                    tileTexture = tileSize == 16 ? flame16Texture : flame32Texture;
-                } else if (weight == 2556.0f) { // Zelda Sword
-                    tileColor = BLACK;
-                    tileTexture = tileSize == 16 ? sword16Texture : sword32Texture;
-                } else { // Default
-                    tileColor = GREEN;
-                    tileTexture = tileSize == 16 ? black16Texture : black32Texture;
+        view.Begin();
+
+        const int tileSize = WorldView::TILE_SIZE;
+        auto cellChecks = [&](Position pos) {
+            return (float)(player != nullptr ? player->get_checks(pos) : pathfinder->checks(pos));
+        };
+        Position visibleMin, visibleMax;
+        view.visible_tiles(visibleMin, visibleMax);
+
+        if (!view.zoomed_out()) {
+            // Draw tiles, only the ones on screen
+            bool small = view.pixels_per_tile() <= 16;
+
+            // Every tile comes from the atlas, so this whole pass is one batch as long as nothing else is drawn in
+            // between
+            const TerrainPalette& palette = world->get_palette();
+            for (int y = visibleMin.second; y < visibleMax.second; ++y) {
+                for (int x = visibleMin.first; x < visibleMax.first; ++x) {
+                    Tile tile = palette[world->get_terrain({x, y})].tile;
+                    tileAtlas.Draw(tile, small, {(float)x * tileSize, (float)y * tileSize, tileSize, tileSize});
                 }
+            }
 
-                if (tileSize >= 16) {
-                    DrawTexture(tileTexture, x * tileSize + mapOffsetX, y * tileSize + mapOffsetY, WHITE);
-                } else {
-                    DrawRectangle(x * tileSize + mapOffsetX, y * tileSize + mapOffsetY, tileSize, tileSize, tileColor);
+            // Draw check counts
+            for (int y = visibleMin.second; y < visibleMax.second; ++y) {
+                for (int x = visibleMin.first; x < visibleMax.first; ++x) {
+                    float checks = cellChecks({x, y});
+                    if (checks > 0)
+                        DrawRectangle(x * tileSize, y * tileSize, tileSize, tileSize, Fade(RED, checks / (checks + 5)));
                 }
+            }
+        } else {
+            view.DrawOverview();
+
+            // Draw check counts in blocks of at least LOD_PIXELS_PER_TILE pixels, sampling along each block's diagonal
+            // so the number of lookups and draws depends on the screen instead of the world
+            int stride = (int)std::ceil(WorldView::LOD_PIXELS_PER_TILE / view.pixels_per_tile());
 
-                // Draw check count
-                float checks = (float)pathfinder->checks(pos);
-                if (checks > 0)
-                    DrawRectangle(x * tileSize + mapOffsetX, y * tileSize + mapOffsetY, tileSize, tileSize,
-                                  Fade(RED, checks / (checks + 5)));
+            for (int y = visibleMin.second - visibleMin.second % stride; y < visibleMax.second; y += stride) {
+                for (int x = visibleMin.first - visibleMin.first % stride; x < visibleMax.first; x += stride) {
+                    float checks = 0;
+                    for (int i = 0; i < stride && x + i < visibleMax.first && y + i < visibleMax.second; i++)
+                        checks = std::max(checks, cellChecks({x + i, y + i}));
+
+                    if (checks > 0)
+                        DrawRectangle(x * tileSize, y * tileSize, stride * tileSize, stride * tileSize,
+                                      Fade(RED, checks / (checks + 5)));
+                }
             }
         }
 
         // Draw spawn, goals, and destination
-        if (tileSize >= 16) {
-            Texture2D spawnTexture = tileSize == 16 ? alberta16Texture : alberta32Texture;
-            Texture2D goalTexture = tileSize == 16 ? coin16Texture : coin32Texture;
-            Texture2D destinationTexture = selectedMap == 4 ? tileSize == 16 ? oldMan16Texture : oldMan32Texture
-                                           : tileSize == 16 ? gem16Texture
-                                                            : gem32Texture;
-
-            DrawTexture(spawnTexture, world->get_spawn().first * tileSize + mapOffsetX,
-                        world->get_spawn().second * tileSize + mapOffsetY, WHITE);
+        if (!view.zoomed_out()) {
+            bool small = view.pixels_per_tile() <= 16;
+            auto drawMarker = [&](Tile tile, Position pos) {
+                tileAtlas.Draw(tile, small,
+                               {(float)pos.first * tileSize, (float)pos.second * tileSize, tileSize, tileSize});
+            };
+
+            drawMarker(Tile::Alberta, world->get_spawn());
             for (auto goal : world->get_goals())
-                DrawTexture(goalTexture, goal.first * tileSize + mapOffsetX, goal.second * tileSize + mapOffsetY,
-                            WHITE);
-            DrawTexture(destinationTexture, world->get_destination().first * tileSize + mapOffsetX,
-                        world->get_destination().second * tileSize + mapOffsetY, WHITE);
+                drawMarker(Tile::Coin, goal);
+            drawMarker(selectedMap == 4 ? Tile::OldMan : Tile::Gem, world->get_destination());
         } else {
-            DrawRectangle(world->get_spawn().first * tileSize + mapOffsetX,
-                          world->get_spawn().second * tileSize + mapOffsetY, tileSize, tileSize, RED);
+            // Markers keep a minimum size on screen so they do not vanish when zoomed out
+            float markerSize = view.min_marker_size();
+            auto drawMarker = [&](Color color, Position pos) {
+                Vector2 center = view.tile_center(pos);
+                DrawRectangle(center.x - markerSize / 2, center.y - markerSize / 2, markerSize, markerSize, color);
+            };
+
+            drawMarker(RED, world->get_spawn());
             for (auto goal : world->get_goals())
-                DrawRectangle(goal.first * tileSize + mapOffsetX, goal.second * tileSize + mapOffsetY, tileSize,
-                              tileSize, GOLD);
-            DrawRectangle(world->get_destination().first * tileSize + mapOffsetX,
-                          world->get_destination().second * tileSize + mapOffsetY, tileSize, tileSize, PURPLE);
+                drawMarker(GOLD, goal);
+            drawMarker(PURPLE, world->get_destination());
         }
 
-        // Draw optimal path
-        if (tileSize >= 16) {
+        // Draws a path (IN REVERSE ORDER), with loopbacks offset so overlapping legs stay visible
+        auto drawPath = [&](const std::deque<Position>& path, Color color) {
+            if (path.empty())
+                return;
+
             int loopbacks = 1;
-            auto path = pathfinder->get_current_path();
             size_t path_i = path.size() - 1;
             Position last_turn = Position(-1, -1);
             int traveled = 0;
+
+            auto drawSegment = [&](Position from, Position to) {
+                int side = loopbacks % 2 == 0 ? 1 : -1;
+                int offset = tileSize / 2 + (loopbacks / 2) * LINE_SEPERATION * side;
+                DrawLine(from.first * tileSize + offset, from.second * tileSize + offset, to.first * tileSize + offset,
+                         to.second * tileSize + offset, color);
+            };
+
             while (path_i >= 0) {
                 if (last_turn.first == -1)
                     last_turn = path[path_i];
 
                 if ((path[path_i].first != last_turn.first && path[path_i].second != last_turn.second)) {
-                    int side = loopbacks % 2 == 0 ? 1 : -1;
-                    DrawLine(path[path_i + 1].first * tileSize + tileSize / 2 +
-                                 ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetX,
-                             path[path_i + 1].second * tileSize + tileSize / 2 +
-                                 ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetY,
-                             last_turn.first * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) +
-                                 mapOffsetX,
-                             last_turn.second * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) +
-                                 mapOffsetY,
-                             PATHFINDER_COLOR);
+                    drawSegment(path[path_i + 1], last_turn);
                     last_turn = path[path_i + 1];
                     traveled = 0;
                 }
 
                 if (traveled > distance(last_turn, path[path_i])) {
-                    int side = loopbacks % 2 == 0 ? 1 : -1;
-                    DrawLine(path[path_i + 1].first * tileSize + tileSize / 2 +
-                                 ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetX,
-                             path[path_i + 1].second * tileSize + tileSize / 2 +
-                                 ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetY,
-                             last_turn.first * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) +
-                                 mapOffsetX,
-                             last_turn.second * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) +
-                                 mapOffsetY,
-                             PATHFINDER_COLOR);
+                    drawSegment(path[path_i + 1], last_turn);
 
                     last_turn = path[path_i + 1];
 
@@ -311,33 +380,67 @@ int main() {
 
                 path_i--;
             }
-            int side = loopbacks % 2 == 0 ? 1 : -1;
-            DrawLine(
-                path[path_i].first * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetX,
-                path[path_i].second * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetY,
-                last_turn.first * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetX,
-                last_turn.second * tileSize + tileSize / 2 + ((loopbacks / 2) * LINE_SEPERATION * side) + mapOffsetY,
-                PATHFINDER_COLOR);
+            drawSegment(path[path_i], last_turn);
+        };
+
+        if (player != nullptr) {
+            // Only expansions are recorded, so show where the search is and the final path once it is reached
+            if (player->get_step() == player->step_count() && player->search_completed()) {
+                drawPath(player->get_path(), PATHFINDER_COLOR);
+            } else {
+                Vector2 center = view.tile_center(player->get_current_position());
+                float markerSize = view.min_marker_size();
+                DrawRectangleLinesEx({center.x - markerSize / 2, center.y - markerSize / 2, markerSize, markerSize},
+                                     markerSize / 8, PATHFINDER_COLOR);
+            }
         } else {
-            for (auto pos : pathfinder->get_current_path()) {
-                DrawRectangle(pos.first * tileSize + mapOffsetX, pos.second * tileSize + mapOffsetY, tileSize, tileSize,
-                              PATHFINDER_COLOR);
+            // Draw optimal path, while an anytime search is still improving show its best solution underneath
+            if (pathfinder->completed()) {
+                drawPath(pathfinder->get_best_path(), PATHFINDER_COLOR);
+            } else {
+                if (pathfinder->has_solution())
+                    drawPath(pathfinder->get_best_path(), BEST_PATH_COLOR);
+
+                drawPath(pathfinder->get_current_path(), PATHFINDER_COLOR);
+            }
+
+            size_t goal_path_i = 0;
+            auto goal_path = pathfinder->get_current_goal_path();
+            while (goal_path_i < goal_path.size() - 1) {
+                Color color = goal_path_i + 1 < pathfinder->get_goal_progress() ? BLUE : RED;
+                if (pathfinder->completed())
+                    color = GREEN;
+
+                DrawLine(goal_path[goal_path_i].first * tileSize + tileSize / 2,
+                         goal_path[goal_path_i].second * tileSize + tileSize / 2,
+                         goal_path[goal_path_i + 1].first * tileSize + tileSize / 2,
+                         goal_path[goal_path_i + 1].second * tileSize + tileSize / 2, color);
+
+                goal_path_i++;
             }
         }
 
-        size_t goal_path_i = 0;
-        auto goal_path = pathfinder->get_current_goal_path();
-        while (goal_path_i < goal_path.size() - 1) {
-            Color color = goal_path_i + 1 < pathfinder->get_goal_progress() ? BLUE : RED;
-            if (pathfinder->completed())
-                color = GREEN;
+        view.End();
 
-            DrawLine(goal_path[goal_path_i].first * tileSize + tileSize / 2 + mapOffsetX,
-                     goal_path[goal_path_i].second * tileSize + tileSize / 2 + mapOffsetY,
-                     goal_path[goal_path_i + 1].first * tileSize + tileSize / 2 + mapOffsetX,
-                     goal_path[goal_path_i + 1].second * tileSize + tileSize / 2 + mapOffsetY, color);
+        if (player != nullptr) {
+            float progress = player->step_count() > 0 ? (float)player->get_step() / player->step_count() : 1;
+            DrawRectangleRec(scrubRect, Fade(DARKGRAY, 0.8f));
+            DrawRectangle(scrubRect.x, scrubRect.y, scrubRect.width * progress, scrubRect.height, PATHFINDER_COLOR);
+        }
 
-            goal_path_i++;
+        // Draw search stats overlay, recorded searches carry no stats so it would only show the live pathfinder's
+        if (showStats && player == nullptr) {
+            PathFinderStats stats = pathfinder->stats();
+            DrawRectangle(10, 10, 300, 212, Fade(BLACK, 0.7f));
+            DrawText(TextFormat("Expanded: %zu", stats.nodes_expanded), 20, 20, 20, WHITE);
+            DrawText(TextFormat("Pushes: %zu", stats.pushes), 20, 42, 20, WHITE);
+            DrawText(TextFormat("Stale Pops: %zu", stats.stale_pops), 20, 64, 20, WHITE);
+            DrawText(TextFormat("Re-expansions: %zu", stats.re_expansions), 20, 86, 20, WHITE);
+            DrawText(TextFormat("Peak Open Set: %zu", stats.peak_open_set), 20, 108, 20, WHITE);
+            DrawText(TextFormat("Goal Transitions: %zu", stats.goal_transitions), 20, 130, 20, WHITE);
+            DrawText(TextFormat("Heuristic Calls: %zu", stats.heuristic_calls), 20, 152, 20, WHITE);
+            DrawText(TextFormat("Corridor Cells: %zu", stats.corridor_cells), 20, 174, 20, WHITE);
+            DrawText(TextFormat("Search Memory: %.1f KiB", stats.search_bytes / 1024.0f), 20, 196, 20, WHITE);
         }
 
         DrawRectangleRec(dropdownRect, LIGHTGRAY);
@@ -392,19 +495,40 @@ int main() {
                  restartButton.y + restartButton.height / 2 - reset_text_size.y / 2, 20, WHITE);
 
         // Draw informational text
-        DrawText(TextFormat("Current Algorithm: %s", algorithms[selectedAlgorithm]), 10, 750, 20, WHITE);
-        DrawText(TextFormat("Current Map: %s", maps[selectedMap]), 10, 775, 20, WHITE);
+        if (player != nullptr) {
+            DrawText(TextFormat("Playback: %s, Step %zu / %zu", player->get_algorithm().c_str(), player->get_step(),
+                                player->step_count()),
+                     10, 750, 20, WHITE);
+            if (player->get_step() == player->step_count() && player->search_completed())
+                DrawText(TextFormat("Cost: %.1f", player->get_cost()), 500, 750, 20, SKYBLUE);
+            DrawText(TextFormat("Current Map: %s", player->get_map().c_str()), 10, 775, 20, WHITE);
+        } else {
+            DrawText(TextFormat("Current Algorithm: %s", algorithms[selectedAlgorithm]), 10, 750, 20, WHITE);
+            if (algorithmOptions[selectedAlgorithm].mode != SearchMode::Exact && pathfinder->has_solution())
+                DrawText(TextFormat("Cost: %.1f, Within %.2fx Of Optimal", pathfinder->get_best_cost(),
+                                    pathfinder->get_suboptimality_bound()),
+                         400, 750, 20, SKYBLUE);
+            DrawText(TextFormat("Current Map: %s", maps[selectedMap]), 10, 775, 20, WHITE);
+        }
         DrawText(TextFormat("Current Speed: %s", speeds[selectedSpeed]), 10, 800, 20, WHITE);
         DrawText("Click 'Start' to automatically find an optimal path.", 10, 825, 20, WHITE);
         DrawText("Click 'Step' to manually step the pathfinder.", 10, 850, 20, WHITE);
-        DrawText("Click 'Reset' to clear the board!", 10, 875, 20, WHITE);
+        DrawText("Click 'Reset' to clear the board! Press 'I' for search stats.", 10, 875, 20, WHITE);
+        DrawText("Scroll to zoom, right drag to pan, 'F' to fit.", 400, 800, 20, WHITE);
 
         EndDrawing();
 
         currentFrame++;
     }
 
+    delete player;
+    delete pathfinder;
+    delete hierarchy;
     delete world; // Free allocated memory
+    view.Unload();
+    tileAtlas.Unload();
     CloseWindow();
+
+    Trace::EndSession();
     return 0;
 }